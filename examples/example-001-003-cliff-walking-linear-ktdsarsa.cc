@@ -0,0 +1,95 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+/*
+   This example solves the cliff walking problem with KTD-SARSA, using
+   rl::gsl::LinearKTD. The Q-function is tabular, i.e. linear with
+   sparse features (one-hot vectors). The Kalman update is then
+   performed in closed form, in O(n^2), and the greedy policy is
+   computed from the critic itself, that also provides the variance
+   of its estimation.
+   */
+
+#include <rl.hpp>
+#include <random>
+#include <cmath>
+
+using     Cliff = rl::problem::cliff_walking::Cliff<20,6>;
+using     Param = rl::problem::cliff_walking::Param;     
+using Simulator = rl::problem::cliff_walking::Simulator<Cliff,Param>;
+
+// Definition of Reward, S, A, SA, Transition and TransitionSet.
+#include "example-defs-transition.hpp"
+
+// Definition a tabular parametrization of the Q-Value.
+#include "example-defs-tabular-cliff.hpp"
+
+
+// Let us define the parameters.
+#define paramGAMMA                 .99
+#define paramEPSILON               .2
+#define paramETA_NOISE             1e-3
+#define paramOBSERVATION_NOISE     1
+#define paramPRIOR_VAR             10
+#define paramRANDOM_AMPLITUDE      0
+
+// This stores pieces of codes shared by our example experiments.
+#include "example-defs-cliff-experiments.hpp"
+
+int main(int argc, char* argv[]) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    gsl_vector* theta = gsl_vector_alloc(TABULAR_Q_CARDINALITY);
+
+    // phi(s,a) is the one-hot vector of (s,a).
+    auto phi = [](rl::gsl::SparseVector& phi_sa, const S& s, const A& a) -> void {
+        phi_sa.set_basis(TABULAR_Q_RANK(s,a));
+    };
+
+    auto critic = rl::gsl::linear_ktd<S,A>(theta,phi,
+            paramGAMMA,
+            paramETA_NOISE,
+            paramOBSERVATION_NOISE,
+            paramPRIOR_VAR,
+            paramRANDOM_AMPLITUDE,
+            gen);
+
+    // The critic evaluates q(theta,s,a) itself.
+    auto q = [&critic](const S& s, const A& a) -> double {return critic(s,a);};
+
+    make_experiment(critic,q, gen);
+
+    // The variance of the estimation is available as well. Here, a
+    // workspace is given to the critic for this query.
+    auto   ws = critic.workspace();
+    double var;
+    double q_start = critic(Cliff::start,rl::problem::cliff_walking::Action::actionNorth,var,ws);
+    std::cout << "Q(start,north) = " << q_start << " +/- " << std::sqrt(var) << std::endl;
+
+    gsl_vector_free(theta);
+    return 0;
+}
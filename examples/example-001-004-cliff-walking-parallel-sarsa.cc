@@ -0,0 +1,113 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+/*
+   This example is the SARSA of example-001-001, where the episodes
+   are run by several threads. Each thread has its own simulator,
+   policy and critic, but all the critics update the same parameter
+   theta, with no lock (Hogwild-like learning). The tabular gradient
+   is sparse, so that each update only concerns one component of
+   theta, and the critics are used in concurrent mode, where that
+   component is updated by an atomic addition.
+   */
+
+#include <rl.hpp>
+#include <random>
+
+using     Cliff = rl::problem::cliff_walking::Cliff<20,6>;
+using     Param = rl::problem::cliff_walking::Param;     
+using Simulator = rl::problem::cliff_walking::Simulator<Cliff,Param>;
+
+// Definition of Reward, S, A, SA, Transition and TransitionSet.
+#include "example-defs-transition.hpp"
+
+// Definition a tabular parametrization of the Q-Value.
+#include "example-defs-tabular-cliff.hpp"
+
+
+// Let us define the parameters.
+#define paramGAMMA   .99
+#define paramALPHA   .05
+#define paramEPSILON .2
+
+#define NB_THREADS     4
+
+// This stores pieces of codes shared by our example experiments.
+#include "example-defs-cliff-experiments.hpp"
+
+using namespace std::placeholders;
+
+int main(int argc, char* argv[]) {
+    std::random_device rd;
+
+    Param param;
+    auto  action_begin = rl::enumerator<A>(rl::problem::cliff_walking::Action::actionNorth);
+    auto  action_end   = action_begin + rl::problem::cliff_walking::actionSize;
+
+    gsl_vector* theta = gsl_vector_alloc(TABULAR_Q_CARDINALITY);
+    gsl_vector_set_zero(theta);
+
+    auto   q       = std::bind(q_parametrized,theta,_1,_2);
+    double epsilon = paramEPSILON;
+
+    // The factories are called by each thread, gen being the random
+    // generator of the thread. The critics built by make_critic all
+    // share theta, parallel_learn switches them in concurrent mode.
+    auto make_simulator = [&param](std::mt19937& gen) {return Simulator(param);};
+    auto make_policy    = [&q,&epsilon,&action_begin,&action_end](std::mt19937& gen) {
+        return rl::policy::epsilon_greedy(q,epsilon,action_begin,action_end,gen);
+    };
+    auto make_critic    = [theta]() {
+        return rl::gsl::sarsa<S,A>(theta,
+                paramGAMMA,paramALPHA,
+                q_parametrized,
+                grad_q_parametrized);
+    };
+    auto start_episode  = [](Simulator& simulator, std::mt19937& gen) {simulator.restart();};
+
+    try {
+        std::cout << "Running " << NB_EPISODES << " episodes on " << NB_THREADS << " threads..." << std::endl;
+        unsigned int nb_steps = rl::episode::parallel_learn<std::mt19937>(NB_EPISODES, NB_THREADS, rd(),
+                make_simulator, make_policy, make_critic, start_episode,
+                MAX_EPISODE_DURATION);
+        std::cout << "... " << nb_steps << " transitions have been learnt." << std::endl
+            << std::endl;
+
+        print_greedy_policy(action_begin, action_end, q);
+
+        Simulator simulator(param);
+        simulator.restart();
+        unsigned int length = rl::episode::run(simulator,rl::policy::greedy(q,action_begin,action_end),MAX_EPISODE_DURATION);
+        std::cout << std::endl
+            << "The greedy policy reaches the goal in " << length << " steps." << std::endl;
+    }
+    catch(rl::exception::Any& e) {
+        std::cerr << "Exception caught : " << e.what() << std::endl; 
+    }
+
+    gsl_vector_free(theta);
+    return 0;
+}
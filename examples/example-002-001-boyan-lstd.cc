@@ -86,17 +86,23 @@ int main(int argc, char* argv[]) {
   
   gsl_vector* theta = gsl_vector_alloc(phi.dimension());
   gsl_vector_set_zero(theta);
-  gsl_vector* tmp = gsl_vector_alloc(phi.dimension());
-  gsl_vector_set_zero(tmp);
-
-  auto v_parametrized = [&phi,tmp](const gsl_vector* th,S s) -> Reward {double res;
-									phi(tmp,s);                 // phi_s = phi(s)
-									gsl_blas_ddot(th,tmp,&res); // res   = th^T  . phi_s
-									return res;};
-  auto grad_v_parametrized = [&phi,tmp](const gsl_vector* th,   
-					gsl_vector* grad_th_s,
-					S s) -> void {phi(tmp,s);                         // phi_s    = phi(s)
-						      gsl_vector_memcpy(grad_th_s,tmp);}; // grad_th_s = phi_s
+  // v_parametrized(th,s) = th^T . phi(s). It holds no shared scratch,
+  // so it can be used by several threads at once.
+  auto v_parametrized = rl::gsl::linear<S>(phi,phi.dimension());
+  auto grad_v_parametrized = [&phi](const gsl_vector* th,   
+				    gsl_vector* grad_th_s,
+				    S s) -> void {phi(grad_th_s,s);}; // grad_th_s = phi_s
+  // The same gradient, as a sparse vector of the non null features,
+  // for rl::sparse_lstd.
+  gsl_vector* phi_s = gsl_vector_alloc(phi.dimension());
+  auto sparse_grad_v_parametrized = [&phi,phi_s](const gsl_vector* th,
+						 rl::gsl::SparseVector& grad_th_s,
+						 S s) -> void {
+    phi(phi_s,s);
+    for(std::size_t i = 0; i < phi_s->size; ++i)
+      if(gsl_vector_get(phi_s,i) != 0)
+	grad_th_s.add(i,gsl_vector_get(phi_s,i));
+  };
 
   std::chrono::steady_clock::time_point begin;
   std::chrono::steady_clock::time_point end;
@@ -138,6 +144,30 @@ int main(int argc, char* argv[]) {
 	      << "   " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" 
 	      << std::endl;
 
+    gsl_vector_set_zero(theta);
+    // The LSTD matrix can be stored as a sparse matrix, the system
+    // being solved iteratively. This is the way to go with many
+    // sparse features (tabular, tile coding).
+    begin = std::chrono::steady_clock::now();
+    rl::sparse_lstd(theta,
+		    paramGAMMA,paramREG,
+		    transitions.begin(),transitions.end(),
+		    sparse_grad_v_parametrized,
+		    [](const Transition& t) -> S      {return t.s;},
+		    [](const Transition& t) -> S      {return t.s_;},
+		    [](const Transition& t) -> Reward {return t.r;},
+		    [](const Transition& t) -> bool   {return t.is_terminal;},
+		    1e-10, 1000);
+    end = std::chrono::steady_clock::now();
+    
+    std::cout << "sparse LSTD estimation   : ("
+	      << std::setw(15) << gsl_vector_get(theta,0) << ','
+	      << std::setw(15) << gsl_vector_get(theta,1) << ','
+	      << std::setw(15) << gsl_vector_get(theta,2) << ','
+	      << std::setw(15) << gsl_vector_get(theta,3) << ')'
+	      << "   " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" 
+	      << std::endl;
+
     gsl_vector_set_zero(theta);
     // Now, we have to apply recursive LSTD to the transition database.
     begin = std::chrono::steady_clock::now();
@@ -239,7 +269,7 @@ int main(int argc, char* argv[]) {
     std::cerr << "Exception caught : " << e.what() << std::endl;
   }
   
+  gsl_vector_free(phi_s);
   gsl_vector_free(theta);
-  gsl_vector_free(tmp);
   return 0;
 }
@@ -37,6 +37,7 @@
 #include <cmath>
 #include <fstream>
 #include <functional>
+#include <thread>
 
 using namespace std::placeholders;
 
@@ -65,48 +66,46 @@ int main(int argc, char* argv[]) {
     std::random_device rd;
     std::mt19937 gen(rd());
 
-    int             episode,step;
+    int             step;
     std::ofstream   ofile;
 
-    Simulator       simulator(gen);
     TransitionSet   transitions;
 
     gsl_vector* theta = gsl_vector_alloc(PHI_RBF_DIMENSION);
     gsl_vector_set_zero(theta);
-    gsl_vector* tmp = gsl_vector_alloc(PHI_RBF_DIMENSION);
-    gsl_vector_set_zero(tmp);
-
-    auto q_parametrized = [tmp](const gsl_vector* th,S s, A a) -> Reward {double res;
-        phi_rbf(tmp,s,a);           // phi_sa = phi(s,a)
-        gsl_blas_ddot(th,tmp,&res); // res    = th^T  . phi_sa
-        return res;};
-    auto grad_q_parametrized = [tmp](const gsl_vector* th,   
+    auto grad_q_parametrized = [](const gsl_vector* th,   
             gsl_vector* grad_th_s,
-            S s, A a) -> void {phi_rbf(tmp,s,a);   // phi_sa    = phi(s,a)
-        gsl_vector_memcpy(grad_th_s,tmp);};        // grad_th_s = phi_sa
-
-    auto q = std::bind(q_parametrized,theta,_1,_2);
+            S s, A a) -> void {phi_rbf(grad_th_s,s,a);}; // grad_th_s = phi_sa
 
     rl::enumerator<A> a_begin(rl::problem::inverted_pendulum::Action::actionNone);
     rl::enumerator<A> a_end = a_begin+3;
 
+    // This is q(s,a) = q_parametrized(theta,s,a). It also provides
+    // q.q_all(s,values), that greedy policies use to evaluate all the
+    // actions from a single computation of the state features.
+    auto q = rl::gsl::linear_q<S>(theta,phi_rbf_state,PHI_RBF_STATE_DIMENSION,a_begin,a_end);
+
     auto random_policy = rl::policy::random(a_begin,a_end,gen);
     auto greedy_policy = rl::policy::greedy(q,a_begin,a_end);
 
     try {
         // Let us fill a set of transitions from successive episodes,
-        // using a random policy.
-        for(episode=0;episode<NB_OF_EPISODES;++episode) {
-            Simulator::phase_type start_phase;
-            start_phase.random(gen);
-            simulator.setPhase(start_phase);
-            rl::episode::run(simulator,
-                    random_policy,
-                    std::back_inserter(transitions),
-                    make_transition,
-                    make_terminal_transition,
-                    0);
-        }
+        // using a random policy. The episodes are run in parallel,
+        // each thread having its own simulator, policy and random
+        // generator. The resulting set only depends on the seed.
+        rl::episode::parallel_run<std::mt19937>(NB_OF_EPISODES,
+                std::thread::hardware_concurrency(),
+                rd(),
+                [](std::mt19937& g) {return Simulator(g);},
+                [a_begin,a_end](std::mt19937& g) {return rl::policy::random(a_begin,a_end,g);},
+                [](Simulator& sim, std::mt19937& g) {
+                    Simulator::phase_type start_phase;
+                    start_phase.random(g);
+                    sim.setPhase(start_phase);},
+                std::back_inserter(transitions),
+                make_transition,
+                make_terminal_transition,
+                0);
 
         // Let us try the random policy
         test_iteration(random_policy,0, gen);
@@ -114,21 +113,28 @@ int main(int argc, char* argv[]) {
         // Let us used LSTD as a batch critic. LSTD considers transitions
         // as (Z,r,Z'), but Z is a pair (s,a) here. See the definitions of
         // current_of,next_of,reward_of, and note that
-        // gradvparam_of_gradqparam transforms Q(s,a) into V(z).
+        // gradvparam_of_gradqparam transforms Q(s,a) into V(z). The
+        // accumulation over the transitions is shared out among threads,
+        // grad_q_parametrized being thread-safe, each thread updating its
+        // LSTD matrix by blocks of 64 transitions.
         auto critic = [theta,grad_q_parametrized](const TransitionSet::iterator& t_begin,
                 const TransitionSet::iterator& t_end) -> void {
-            rl::lstd(theta,paramGAMMA,paramREG,
+            rl::parallel_lstd(theta,paramGAMMA,paramREG,
                     t_begin,t_end,
                     rl::sa::gsl::gradvparam_of_gradqparam<S,A,Reward>(grad_q_parametrized),
-                    current_of,next_of,reward_of,is_terminal);
+                    current_of,next_of,reward_of,is_terminal,
+                    std::thread::hardware_concurrency(), 64);
         };
 
-        // Now, let us improve the policy and measure its performance at each step.
+        // Now, let us improve the policy and measure its performance
+        // at each step. The greedy actions of the next states are
+        // computed in parallel as well, q being thread-safe.
         for(step = 1 ; step <= NB_ITERATION_STEPS ; ++step) {
-            rl::batch_policy_iteration_step(critic,q,
+            rl::parallel_batch_policy_iteration_step(critic,q,
                     transitions.begin(),transitions.end(),
                     a_begin,a_end,
-                    is_terminal,next_state_of,set_next_action);
+                    is_terminal,next_state_of,set_next_action,
+                    std::thread::hardware_concurrency());
             test_iteration(greedy_policy,step, gen);
         }
 
@@ -142,6 +148,19 @@ int main(int argc, char* argv[]) {
             ofile.close();
         }
 
+        // theta can also be saved as a binary snapshot. A process that
+        // only serves the greedy policy can map the snapshot and use
+        // the mapped array as its parameter, without reading the file.
+        std::cout << "Writing lspi.snapshot" << std::endl;
+        rl::snapshot::Writer writer;
+        writer.add("theta", theta);
+        writer.save("lspi.snapshot");
+
+        rl::snapshot::Mapping mapping("lspi.snapshot");
+        gsl_vector_view served_theta = mapping.vector("theta");
+        auto served_q = rl::gsl::linear_q<S>(&(served_theta.vector),phi_rbf_state,PHI_RBF_STATE_DIMENSION,a_begin,a_end);
+        test_iteration(rl::policy::greedy(served_q,a_begin,a_end),step, gen);
+
     }
     catch(rl::exception::Any& e) {
         std::cerr << "Exception caught : " << e.what() << std::endl;
@@ -0,0 +1,168 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+/*
+   This example is example-002-002, except that the transitions are
+   stored on disk, in a columnar dataset (see rl::dataset), rather
+   than in a std::vector. LSPI then runs on the memory-mapped files,
+   so the dataset does not have to fit in memory. The transitions are
+   generated by a batch simulator, that runs many pendulums at once.
+   */
+
+#include <rl.hpp>
+#include <iostream>
+#include <iomanip>
+#include <gsl/gsl_vector.h>
+#include <cmath>
+#include <vector>
+#include <thread>
+
+using namespace std::placeholders;
+
+// This is our simulator.
+using Simulator      = rl::problem::inverted_pendulum::Simulator<rl::problem::inverted_pendulum::DefaultParam, std::mt19937>;
+using BatchSimulator = rl::problem::inverted_pendulum::BatchSimulator<rl::problem::inverted_pendulum::DefaultParam, std::mt19937>;
+
+// Definition of Reward, S, A, Transition and TransitionSet.
+#include "example-defs-transition.hpp"
+
+// Features and a RBF architecture.
+#include "example-defs-pendulum-architecture.hpp"
+
+
+#define paramREG       0
+#define paramGAMMA    .95
+
+#define NB_OF_EPISODES         1000
+#define NB_LANES                 64
+#define NB_ITERATION_STEPS       10
+#define MAX_EPISODE_LENGTH     3000
+#define NB_LENGTH_SAMPLES        20
+
+#define DATASET_PATH "pendulum-transitions"
+
+#include "example-defs-test-iteration.hpp"
+
+// The transitions of the dataset are handles on its columns. Let us
+// define the reading and setting functions for them.
+using Dataset           = rl::dataset::Mapping<S,A>;
+using MappedTransition  = Dataset::transition_type;
+
+rl::sa::Pair<S,A> mapped_current_of(const MappedTransition& t)    {return {t.s(),t.a()};}
+rl::sa::Pair<S,A> mapped_next_of(const MappedTransition& t)       {return {t.s_(),t.a_()};}
+Reward            mapped_reward_of(const MappedTransition& t)     {return t.r();}
+bool              mapped_is_terminal(const MappedTransition& t)   {return t.is_terminal();}
+S                 mapped_next_state_of(const MappedTransition& t) {return t.s_();}
+void              mapped_set_next_action(const MappedTransition& t, A a) {t.set_next_action(a);}
+
+int main(int argc, char* argv[]) {
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    int step;
+
+    gsl_vector* theta = gsl_vector_alloc(PHI_RBF_DIMENSION);
+    gsl_vector_set_zero(theta);
+    auto grad_q_parametrized = [](const gsl_vector* th,   
+            gsl_vector* grad_th_s,
+            S s, A a) -> void {phi_rbf(grad_th_s,s,a);}; // grad_th_s = phi_sa
+
+    rl::enumerator<A> a_begin(rl::problem::inverted_pendulum::Action::actionNone);
+    rl::enumerator<A> a_end = a_begin+3;
+
+    auto q = rl::gsl::linear_q<S>(theta,phi_rbf_state,PHI_RBF_STATE_DIMENSION,a_begin,a_end);
+
+    auto greedy_policy = rl::policy::greedy(q,a_begin,a_end);
+
+    try {
+        // Let us write the dataset. The transitions are generated by a
+        // batch simulator, that runs NB_LANES pendulums at once with a
+        // random policy. A lane that falls is restarted around the
+        // equilibrium, so that all the lanes are always running. The
+        // next action of a lane is chosen before the transition is
+        // written, since it is stored with it.
+        {
+            rl::dataset::Writer<S,A> writer(DATASET_PATH);
+            BatchSimulator simulator(NB_LANES,gen);
+            auto           random_policy = rl::policy::random(a_begin,a_end,gen);
+            std::vector<S> states(NB_LANES);
+            std::vector<A> actions(NB_LANES);
+            std::vector<A> next_actions(NB_LANES);
+            int            nb_episodes = 0;
+
+            for(unsigned int i = 0; i < NB_LANES; ++i)
+                actions[i] = random_policy(simulator.sense(i));
+            while(nb_episodes < NB_OF_EPISODES) {
+                for(unsigned int i = 0; i < NB_LANES; ++i)
+                    states[i] = simulator.sense(i);
+                simulator.timeStep(actions.data());
+                for(unsigned int i = 0; i < NB_LANES; ++i) {
+                    S next = simulator.sense(i);
+                    next_actions[i] = random_policy(next);
+                    if(simulator.terminal()[i]) {
+                        writer.push(states[i],actions[i],simulator.reward()[i]);
+                        ++nb_episodes;
+                    }
+                    else
+                        writer.push(states[i],actions[i],simulator.reward()[i],next,next_actions[i]);
+                }
+                std::swap(actions,next_actions);
+            }
+            std::cout << writer.size() << " transitions written in " << DATASET_PATH << ".*" << std::endl;
+        } // The writer is closed here.
+
+        // Now, let us map the dataset. Its iterators are used as the
+        // ones of the TransitionSet in example-002-002. The next
+        // actions set by the policy iteration steps only modify a
+        // private copy, DATASET_PATH.a_ keeps the logged ones.
+        Dataset transitions(DATASET_PATH);
+
+        auto critic = [theta,grad_q_parametrized](const Dataset::iterator& t_begin,
+                const Dataset::iterator& t_end) -> void {
+            rl::parallel_lstd(theta,paramGAMMA,paramREG,
+                    t_begin,t_end,
+                    rl::sa::gsl::gradvparam_of_gradqparam<S,A,Reward>(grad_q_parametrized),
+                    mapped_current_of,mapped_next_of,mapped_reward_of,mapped_is_terminal,
+                    std::thread::hardware_concurrency(), 64);
+        };
+
+        for(step = 1 ; step <= NB_ITERATION_STEPS ; ++step) {
+            rl::parallel_batch_policy_iteration_step(critic,q,
+                    transitions.begin(),transitions.end(),
+                    a_begin,a_end,
+                    mapped_is_terminal,mapped_next_state_of,mapped_set_next_action,
+                    std::thread::hardware_concurrency());
+            test_iteration(greedy_policy,step, gen);
+        }
+    }
+    catch(rl::exception::Any& e) {
+        std::cerr << "Exception caught : " << e.what() << std::endl;
+    }
+
+    gsl_vector_free(theta);
+    return 0;
+}
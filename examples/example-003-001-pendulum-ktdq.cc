@@ -90,13 +90,8 @@ int main(int argc, char* argv[]) {
 
     gsl_vector* theta = gsl_vector_alloc(PHI_RBF_DIMENSION);
     gsl_vector_set_zero(theta);
-    gsl_vector* tmp = gsl_vector_alloc(PHI_RBF_DIMENSION);
-    gsl_vector_set_zero(tmp);
-
-    auto q_parametrized = [tmp](const gsl_vector* th,S s, A a) -> Reward {double res;
-        phi_rbf(tmp,s,a);           // phi_sa = phi(s,a)
-        gsl_blas_ddot(th,tmp,&res); // res    = th^T  . phi_sa
-        return res;};
+    // q_parametrized(th,s,a) = th^T . phi_rbf(s,a)
+    auto q_parametrized = rl::gsl::linear<S,A>(phi_rbf,PHI_RBF_DIMENSION);
 
     auto q = std::bind(q_parametrized,theta,_1,_2);
 
@@ -39,6 +39,7 @@
 #include <cmath>
 #include <functional>
 #include <random>
+#include <thread>
 
 using namespace std::placeholders;
 
@@ -125,6 +126,10 @@ int main(int argc, char* argv[]) {
             paramUSE_LINEAR_EVALUATION,
             gen);
 
+    // The MLP can be evaluated by several threads at once, so the
+    // sigma-point images can be computed in parallel.
+    critic.parallel_evaluation(std::thread::hardware_concurrency());
+
     make_experiment(critic,q,a_begin,a_end,gen);
 
     return 0;
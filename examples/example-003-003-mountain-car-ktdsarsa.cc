@@ -168,14 +168,8 @@ void train(int nb_episodes, bool make_movie, RANDOM_GENERATOR& gen) {
 
     gsl_vector* theta = gsl_vector_alloc(PHI_RBF_DIMENSION);
     gsl_vector_set_zero(theta);
-    gsl_vector* tmp = gsl_vector_alloc(PHI_RBF_DIMENSION);
-    gsl_vector_set_zero(tmp);
-
-    auto q_parametrized = [tmp,&phi](const gsl_vector* th,S s, A a) -> Reward {
-        double res;
-        phi(tmp,s,a);           // phi_sa = phi(s,a)
-        gsl_blas_ddot(th,tmp,&res); // res    = th^T  . phi_sa
-        return res;};
+    // q_parametrized(th,s,a) = th^T . phi(s,a)
+    auto q_parametrized = rl::gsl::linear<S,A>(phi,PHI_RBF_DIMENSION);
 
     auto q = std::bind(q_parametrized,theta,_1,_2);
 
@@ -204,6 +198,9 @@ void train(int nb_episodes, bool make_movie, RANDOM_GENERATOR& gen) {
             paramUSE_LINEAR_EVALUATION,
             gen);
 
+    // The covariance factor is updated by an O(n^2) Cholesky downdate.
+    critic.use_square_root_update = true;
+
     try {
 
         step = 0;
@@ -275,13 +272,8 @@ void test(const Simulator::phase_type& start, RANDOM_GENERATOR& gen) {
 
     gsl_vector* theta = gsl_vector_alloc(PHI_RBF_DIMENSION);
     gsl_vector_set_zero(theta);
-    gsl_vector* tmp = gsl_vector_alloc(PHI_RBF_DIMENSION);
-    gsl_vector_set_zero(tmp);
-
-    auto q_parametrized = [tmp,&phi](const gsl_vector* th,S s, A a) -> Reward {double res;
-        phi(tmp,s,a);           // phi_sa = phi(s,a)
-        gsl_blas_ddot(th,tmp,&res); // res    = th^T  . phi_sa
-        return res;};
+    // q_parametrized(th,s,a) = th^T . phi(s,a)
+    auto q_parametrized = rl::gsl::linear<S,A>(phi,PHI_RBF_DIMENSION);
 
     auto q = std::bind(q_parametrized,theta,_1,_2);
 
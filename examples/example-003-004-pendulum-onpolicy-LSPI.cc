@@ -66,6 +66,7 @@ using Simulator = rl::problem::inverted_pendulum::Simulator<rl::problem::inverte
 #define NB_OF_EPISODES             500
 #define NB_OF_TESTING_EPISODES      50
 #define MAX_EPISODE_LENGTH        3000
+#define THETA_PERIOD                10
 
 int main(int argc, char* argv[]) {
 
@@ -77,12 +78,8 @@ int main(int argc, char* argv[]) {
     Simulator       simulator(gen);
 
     gsl_vector* theta = gsl_vector_calloc(PHI_RBF_DIMENSION);
-    gsl_vector* tmp = gsl_vector_calloc(PHI_RBF_DIMENSION);
-
-    auto q_parametrized = [tmp](const gsl_vector* th,S s, A a) -> Reward {double res;
-        phi_rbf(tmp,s,a);           // phi_sa = phi(s,a)
-        gsl_blas_ddot(th,tmp,&res); // res    = th^T  . phi_sa
-        return res;};
+    // q_parametrized(th,s,a) = th^T . phi_rbf(s,a)
+    auto q_parametrized = rl::gsl::linear<S,A>(phi_rbf,PHI_RBF_DIMENSION);
 
 
     auto q = std::bind(q_parametrized,theta,_1,_2);
@@ -90,6 +87,10 @@ int main(int argc, char* argv[]) {
     // We instantiate our LSTD-Q
     //auto critic = rl::gsl::LSTDQ_Lambda<S, A>(theta, paramGAMMA, paramREG, .4, NB_OF_TRANSITIONS_WARMUP, phi_rbf);
     auto critic = rl::gsl::LSTDQ<S, A>(theta, paramGAMMA, paramREG, NB_OF_TRANSITIONS_WARMUP, phi_rbf);
+    // theta = C.b costs as much as the statistics update. It is
+    // enough to compute it every THETA_PERIOD transitions, the greedy
+    // policy acting on a slightly outdated Q meanwhile.
+    critic.theta_period = THETA_PERIOD;
 
     rl::enumerator<A> a_begin(rl::problem::inverted_pendulum::Action::actionNone);
     rl::enumerator<A> a_end = a_begin+rl::problem::inverted_pendulum::actionSize;
@@ -106,6 +107,7 @@ int main(int argc, char* argv[]) {
             
             // After each episode, we test our policy for NB_OF_TESTING_EPISODES
             // episodes
+            critic.update_theta();
             double cumul_episode_length = 0.0;
             for(unsigned int tepi = 0 ; tepi < NB_OF_TESTING_EPISODES; ++tepi) {
                 start_phase.random(gen);
@@ -0,0 +1,119 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+/*
+   This example shows how to use tile coding, a cheap sparse
+   representation of continuous states, with SARSA. The mountain car
+   problem is solved here. Only the active tiles are computed, and
+   the gradient is a sparse vector, so that each update only concerns
+   a few components of the parameter.
+   */
+
+#include <rl.hpp>
+#include <iostream>
+#include <gsl/gsl_vector.h>
+#include <functional>
+#include <random>
+
+using namespace std::placeholders;
+
+// This is our simulator.
+typedef rl::problem::mountain_car::DefaultParam        mcParam;
+typedef rl::problem::mountain_car::Simulator<mcParam>  Simulator;
+
+
+// Definition of Reward, S, A, Transition and TransitionSet.
+#include "example-defs-transition.hpp"
+
+// Features and architectures (we use TileFeature here).
+#include "example-defs-mountain-car-architecture.hpp"
+
+
+// Let us define the parameters.
+#define paramGAMMA                 .99
+#define paramALPHA                 (.2/TILE_NB_TILINGS)
+#define paramEPSILON               0 // Optimism is enough for exploration.
+
+#define NB_EPISODES                500
+#define MAX_EPISODE_LENGTH_LEARN  1500
+#define MAX_EPISODE_LENGTH_TEST   1500
+
+int main(int argc, char* argv[]) {
+    int episode, episode_length;
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    Simulator   simulator;
+    TileFeature phi;
+
+    // The reward is null until the goal is reached, where it is 1. We
+    // set Q(s,a)=1 everywhere initially, this optimism drives the
+    // exploration.
+    gsl_vector* theta = gsl_vector_alloc(phi.dimension());
+    gsl_vector_set_all(theta,1.0/TILE_NB_TILINGS);
+
+    auto q_parametrized = [&phi](const gsl_vector* th, S s, A a) -> Reward {
+        return phi.q(th,s,a);
+    };
+    auto grad_q_parametrized = [&phi](const gsl_vector* th, rl::gsl::SparseVector& grad_th_sa, S s, A a) -> void {
+        phi.grad(grad_th_sa,s,a);
+    };
+
+    auto q = std::bind(q_parametrized,theta,_1,_2);
+
+    rl::enumerator<A> a_begin(rl::problem::mountain_car::Action::actionNone);
+    rl::enumerator<A> a_end = a_begin+rl::problem::mountain_car::actionSize;
+
+    double epsilon     = paramEPSILON;
+    auto explore_agent = rl::policy::epsilon_greedy(q,epsilon,a_begin,a_end,gen);
+    auto greedy_agent  = rl::policy::greedy(q,a_begin,a_end);
+
+    auto critic = rl::gsl::sarsa<S,A>(theta,
+            paramGAMMA,paramALPHA,
+            q_parametrized,
+            grad_q_parametrized);
+
+    try {
+        for(episode = 0; episode < NB_EPISODES; ++episode) {
+            simulator.setPhase(Simulator::phase_type(Simulator::bottom(),0));
+            episode_length = rl::episode::learn(simulator,explore_agent,critic,MAX_EPISODE_LENGTH_LEARN);
+            if((episode+1) % 50 == 0)
+                std::cout << "Episode " << episode+1 << "/" << NB_EPISODES 
+                    << " : length is " << episode_length << "." << std::endl;
+        }
+
+        simulator.setPhase(Simulator::phase_type(Simulator::bottom(),0));
+        episode_length = rl::episode::run(simulator,greedy_agent,MAX_EPISODE_LENGTH_TEST);
+        std::cout << "From the bottom, the greedy policy needs " << episode_length << " steps." << std::endl;
+    }
+    catch(rl::exception::Any& e) {
+        std::cerr << "Exception caught : " << e.what() << std::endl; 
+    }
+
+    gsl_vector_free(theta);
+    return 0;
+}
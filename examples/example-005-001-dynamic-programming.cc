@@ -0,0 +1,142 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+/*
+  This example shows how to compute the exact solution of tabular
+  problems (garnets, cliff walking) by dynamic programming. This is
+  the ground truth which approximate learners can be compared to.
+*/
+
+#include <rl.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <thread>
+
+// A large random MDP.
+class GarnetParam {
+public:
+  inline static int num_states  (void) { return 100000;}
+  inline static int num_actions (void) { return      4;}
+  inline static int branching   (void) { return      5;}
+};
+using Garnet = rl::problem::garnet::Simulator<GarnetParam, std::mt19937>;
+
+using Cliff  = rl::problem::cliff_walking::Cliff<20,6>;
+using Param  = rl::problem::cliff_walking::Param;
+
+#define paramGAMMA  .95
+#define paramTOL   1e-8
+#define MAX_ITER  10000
+
+int main(int argc, char* argv[]) {
+
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  unsigned int nb_threads = std::thread::hardware_concurrency();
+
+  std::chrono::steady_clock::time_point begin;
+
+  try {
+
+    // The garnet only depends on the seed, its generation being
+    // shared out among threads.
+    begin = std::chrono::steady_clock::now();
+    Garnet garnet(gen, 12345, nb_threads);
+    rl::dp::Model model = garnet.model();
+    std::cout << "Garnet generated in " 
+	      << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count() << " ms" << std::endl;
+
+    // Value iteration, with the two kinds of sweeps. Gauss-Seidel
+    // sweeps use the freshest values, and usually need fewer sweeps.
+    std::vector<double> V_jacobi, V_gs;
+    begin = std::chrono::steady_clock::now();
+    std::size_t nb_sweeps = rl::dp::value_iteration(model, paramGAMMA, V_jacobi,
+						    paramTOL, MAX_ITER,
+						    rl::dp::Sweep::jacobi, nb_threads);
+    std::cout << "Value iteration (Jacobi)       : " << std::setw(5) << nb_sweeps << " sweeps, "
+	      << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count() << " ms" << std::endl;
+
+    begin = std::chrono::steady_clock::now();
+    nb_sweeps = rl::dp::value_iteration(model, paramGAMMA, V_gs,
+					paramTOL, MAX_ITER,
+					rl::dp::Sweep::gauss_seidel, nb_threads);
+    std::cout << "Value iteration (Gauss-Seidel) : " << std::setw(5) << nb_sweeps << " sweeps, "
+	      << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count() << " ms" << std::endl;
+
+    // Policy iteration evaluates each policy exactly, by solving a
+    // sparse linear system.
+    std::vector<unsigned int> policy;
+    std::vector<double>       V_pi;
+    begin = std::chrono::steady_clock::now();
+    std::size_t nb_steps = rl::dp::policy_iteration(model, paramGAMMA, policy, V_pi, MAX_ITER, nb_threads);
+    std::cout << "Policy iteration               : " << std::setw(5) << nb_steps << " steps,  "
+	      << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count() << " ms" << std::endl;
+
+    double err = 0;
+    for(std::size_t s = 0; s < V_pi.size(); ++s)
+      err = std::max(err, std::fabs(V_pi[s] - V_jacobi[s]));
+    std::cout << "max |V_pi - V_vi| = " << err << std::endl
+	      << std::endl;
+
+    // The value of the random policy, for comparison.
+    std::vector<unsigned int> random_policy(model.nb_states);
+    std::vector<double>       V_random;
+    for(auto& a : random_policy)
+      a = std::uniform_int_distribution<unsigned int>(0, model.nb_actions-1)(gen);
+    rl::dp::exact_policy_evaluation(model, paramGAMMA, random_policy, V_random);
+    double mean_opt = 0, mean_random = 0;
+    for(std::size_t s = 0; s < V_pi.size(); ++s) {
+      mean_opt    += V_pi[s];
+      mean_random += V_random[s];
+    }
+    std::cout << "Mean value of the optimal policy : " << mean_opt/model.nb_states << std::endl
+	      << "Mean value of a random policy    : " << mean_random/model.nb_states << std::endl
+	      << std::endl;
+
+    // The cliff walking is not discounted, the goal ending the
+    // episodes. The optimal Q-values can be compared to the ones
+    // learnt by SARSA or Q-learning.
+    Param param;
+    rl::dp::Model cliff = rl::problem::cliff_walking::model<Cliff>(param);
+    std::vector<double> V_cliff, Q_cliff;
+    rl::dp::value_iteration(cliff, 1, V_cliff, paramTOL, MAX_ITER);
+    rl::dp::q_values(cliff, 1, V_cliff, Q_cliff);
+    std::cout << "Cliff walking : V*(start) = " << V_cliff[Cliff::start]
+	      << ", Q*(start, north) = " << Q_cliff[cliff.row(Cliff::start, static_cast<int>(rl::problem::cliff_walking::Action::actionNorth))]
+	      << ", Q*(start, east) = "  << Q_cliff[cliff.row(Cliff::start, static_cast<int>(rl::problem::cliff_walking::Action::actionEast))]
+	      << std::endl;
+    Cliff::draw("V-cliff-optimal", 0, [&V_cliff](int s) {return V_cliff[s];}, V_cliff[Cliff::start], 0);
+  }
+  catch(rl::exception::Any& e) {
+    std::cerr << "Exception caught : " << e.what() << std::endl;
+  }
+
+  return 0;
+}
@@ -77,6 +77,15 @@ void make_experiment(CRITIC& critic, const fctQ& q,
 
         // let us try this loaded ktdq
         test_iteration(greedy_agent,step, gen);           
+
+        // The same state can be saved as a binary snapshot. Loading it
+        // back maps the file in memory and copies the arrays, with no
+        // parsing, which is much faster for large parameter vectors.
+        std::cout << "Writing ktdq.snapshot" << std::endl;
+        rl::snapshot::save(critic, "ktdq.snapshot");
+        std::cout << "Reading ktdq.snapshot" << std::endl;
+        rl::snapshot::load(critic_loaded, "ktdq.snapshot");
+        test_iteration(greedy_agent,step, gen);           
     }
     catch(rl::exception::Any& e) {
         std::cerr << "Exception caught : " << e.what() << std::endl;
@@ -138,3 +138,48 @@ public:
   }
 };
 
+// This is a tile coding of the state space. 10 tilings of a 9x9 grid
+// are used, and the parameter is split into one block per action.
+#define TILE_NB_TILINGS   10
+#define TILE_NB_INTERVALS  9
+
+class TileFeature {
+private:
+
+  rl::gsl::TileCoding<2> tiles;
+
+  static std::size_t action_rank(const A& a) {
+    switch(a) {
+    case rl::problem::mountain_car::Action::actionNone:
+      return 0;
+    case rl::problem::mountain_car::Action::actionBackward:
+      return 1;
+    case rl::problem::mountain_car::Action::actionForward:
+      return 2;
+    default:
+      throw rl::problem::mountain_car::BadAction("in TileFeature");
+    }
+  }
+
+public:
+
+  TileFeature(void) 
+    : tiles(TILE_NB_TILINGS,
+	    {Simulator::param_type::minPosition(), Simulator::param_type::minSpeed()},
+	    {Simulator::param_type::maxPosition(), Simulator::param_type::maxSpeed()},
+	    {TILE_NB_INTERVALS, TILE_NB_INTERVALS}) {}
+
+  std::size_t dimension(void) const {
+    return rl::problem::mountain_car::actionSize*tiles.size();
+  }
+
+  // Q(theta,s,a), in O(TILE_NB_TILINGS).
+  double q(const gsl_vector* theta, const S& s, const A& a) const {
+    return tiles.dot(theta,{s.position,s.speed},action_rank(a)*tiles.size());
+  }
+
+  // grad_theta Q(theta,s,a), that only contains the active tiles.
+  void grad(rl::gsl::SparseVector& grad_theta_sa, const S& s, const A& a) const {
+    tiles(grad_theta_sa,{s.position,s.speed},action_rank(a)*tiles.size());
+  }
+};
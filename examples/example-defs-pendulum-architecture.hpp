@@ -94,4 +94,31 @@ void phi_rbf(gsl_vector *phi, const S& s, const A& a) {
   }
 }
 
+// phi_rbf(s,a) is made of one block of 10 state features per
+// action. This computes that block, i.e. the features of s only, so
+// that Q(s,a) for all actions can be computed from a single
+// evaluation of the gaussians (see rl::gsl::LinearQ).
+#define PHI_RBF_STATE_DIMENSION 10
+void phi_rbf_state(gsl_vector *phi, const S& s) {
+  std::array<double,3> angle = { {-M_PI_4,0,M_PI_4} };
+  std::array<double,3> speed = { {-1,0,1} };
+
+  int i,j,k;
+  double dangle,dspeed;
+
+  if(phi == (gsl_vector*)0)
+    throw rl::exception::NullVectorPtr("in phi_rbf_state()");
+  else if((int)(phi->size) != PHI_RBF_STATE_DIMENSION)
+    throw rl::exception::BadVectorSize(phi->size,PHI_RBF_STATE_DIMENSION,"in phi_rbf_state()");
 
+  gsl_vector_set(phi,0,1);
+  for(i=0,k=1;i<3;++i) {
+    dangle  = s.angle - angle[i];
+    dangle *= dangle;
+    for(j=0;j<3;++j,++k) {
+      dspeed  = s.speed - speed[j];
+      dspeed *= dspeed;
+      gsl_vector_set(phi,k,exp(-.5*(dangle+dspeed))); 
+    }
+  }
+}
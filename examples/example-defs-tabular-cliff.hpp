@@ -36,8 +36,10 @@ double q_parametrized(const gsl_vector* theta,
   return gsl_vector_get(theta,TABULAR_Q_RANK(s,a));
 }
 
+// The gradient is a basis vector. Filling a sparse vector rather
+// than a gsl_vector lets the learners update only that component.
 void grad_q_parametrized(const gsl_vector* theta,   
-			 gsl_vector* grad_theta_sa,
+			 rl::gsl::SparseVector& grad_theta_sa,
 			 S s, A a) {
-  gsl_vector_set_basis(grad_theta_sa,TABULAR_Q_RANK(s,a));
+  grad_theta_sa.set_basis(TABULAR_Q_RANK(s,a));
 }
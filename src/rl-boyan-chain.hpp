@@ -28,6 +28,7 @@
 #include <string>
 #include <sstream>
 #include <random>
+#include <new>
 
 #include <rlException.hpp>
 #include <rlAlgo.hpp>
@@ -194,7 +195,11 @@ namespace rl {
                         return current;
                     }
 
-                    void timeStep(const action_type& a) {
+                    /**
+                     * This is the exception-free transition.
+                     * @return true if a terminal state is reached.
+                     */
+                    bool timeStep(const action_type& a, std::nothrow_t) {
                         std::bernoulli_distribution dis(0.5);
                         if(current>=2) {
                             if(dis(gen))
@@ -209,8 +214,14 @@ namespace rl {
                         }
                         else {
                             r = 0;
-                            throw rl::exception::Terminal("in boyan_chain::Simulator::timeStep");
+                            return true;
                         }
+                        return false;
+                    }
+
+                    void timeStep(const action_type& a) {
+                        if(timeStep(a,std::nothrow))
+                            throw rl::exception::Terminal("in boyan_chain::Simulator::timeStep");
                     }
 
 
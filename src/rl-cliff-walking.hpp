@@ -31,8 +31,10 @@
 #include <iomanip>
 #include <sstream>
 #include <fstream>
+#include <new>
 #include <rlAlgo.hpp>
 #include <rlException.hpp>
+#include <rlDP.hpp>
 #include <gsl/gsl_vector.h>
 
 
@@ -319,7 +321,11 @@ namespace rl {
 	  return current_state;
 	}
 
-	void timeStep(const action_type& a) {
+	/**
+	 * This is the exception-free transition.
+	 * @return true if a terminal state is reached.
+	 */
+	bool timeStep(const action_type& a, std::nothrow_t) {
 	  
 	  switch(current_state) {
 	  case CLIFF::start:
@@ -327,11 +333,17 @@ namespace rl {
 	    break;
 	  case CLIFF::goal:
 	    stepGoal(a);
-	    break;
+	    return true;
 	  default:
 	    step(a);
 	    break;
 	  }
+	  return false;
+	}
+
+	void timeStep(const action_type& a) {
+	  if(timeStep(a,std::nothrow))
+	    throw rl::exception::Terminal("Transition from goal");
 	}
 
       private:
@@ -358,7 +370,6 @@ namespace rl {
 
 	void stepGoal(const action_type a) {
 	  r = param.goalReward();
-	  throw rl::exception::Terminal("Transition from goal");
 	}
 
 	void step(const action_type a) {
@@ -432,6 +443,30 @@ namespace rl {
 	  return *this;
 	}
       };
+
+      /**
+       * @return the model of the cliff walking, for rl::dp. The states
+       * are the phases, the action a is Action(a). Any action from the
+       * goal ends the episode.
+       */
+      template<typename CLIFF, typename CLIFF_PARAM>
+      rl::dp::Model model(const CLIFF_PARAM& param) {
+	Simulator<CLIFF,CLIFF_PARAM> simulator(param);
+	rl::dp::Model m(CLIFF::size, actionSize);
+	for(int s = CLIFF::start; s <= CLIFF::goal; ++s)
+	  for(int a = 0; a < actionSize; ++a) {
+	    std::size_t row = m.row(s, a);
+	    simulator.setPhase(s);
+	    bool terminal = simulator.timeStep(static_cast<Action>(a), std::nothrow);
+	    m.reward[row] = simulator.reward();
+	    if(!terminal) {
+	      m.next_state.push_back(simulator.sense());
+	      m.proba.push_back(1);
+	    }
+	    m.offset[row+1] = m.next_state.size();
+	  }
+	return m;
+      }
       
     }
   }
@@ -37,11 +37,14 @@
 #include <utility>
 #include <algorithm>
 #include <cassert>
-#include <cstring>
-#include <list>
+#include <cstddef>
+#include <cstdint>
+#include <random>
 #include <rlAlgo.hpp>
 #include <rlEpisode.hpp>
 #include <rlException.hpp>
+#include <rlThreadPool.hpp>
+#include <rlDP.hpp>
 
 namespace rl {
   namespace problem {
@@ -53,6 +56,35 @@ namespace rl {
 	  : Any(std::string("Bad action performed : ")+comment) {} 
       };
       
+      /**
+       * @short A small random engine, one per generated row.
+       *
+       * This is SplitMix64, whose state is a single integer, so
+       * that seeding it is free, unlike std::mt19937.
+       */
+      class SplitMix64 {
+      private:
+	std::uint64_t state;
+      public:
+	typedef std::uint64_t result_type;
+
+	static std::uint64_t mix(std::uint64_t z) {
+	  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	  return z ^ (z >> 31);
+	}
+
+	SplitMix64(std::uint64_t seed) : state(seed) {}
+
+	static constexpr result_type min(void) {return 0;}
+	static constexpr result_type max(void) {return ~(result_type)0;}
+
+	result_type operator()(void) {
+	  state += 0x9e3779b97f4a7c15ULL;
+	  return mix(state);
+	}
+      };
+
       // Garnet parameters
       class DefaultParam {
       public:
@@ -79,66 +111,158 @@ namespace rl {
       private:
 	RANDOM_ENGINE& rd;
 	phase_type current_phase;
-	reward_type* rewards;
-	std::list< std::pair<unsigned int, double> >* transition_probabilities;
+	std::vector<reward_type> rewards;
+
+	// The transitions are stored in the CSR format: the arrival
+	// states of (s,a) are next_state[k], k in [offset[s*na+a],
+	// offset[s*na+a+1][, sorted by increasing state number, with
+	// probability proba[k]. Each (s,a) also has an alias table
+	// (alias_proba, alias), so that drawing an arrival state is
+	// O(1) and allocation-free.
+	std::vector<std::size_t>  offset;
+	std::vector<unsigned int> next_state;
+	std::vector<double>       proba;
+	std::vector<double>       alias_proba;
+	std::vector<unsigned int> alias;
 
 	unsigned int ns, na, nb;
-      public:
-	
-	Simulator(RANDOM_ENGINE& rd) : rd(rd) {
-	  ns = GARNET_PARAM::num_states();
-	  na = GARNET_PARAM::num_actions();
-	  nb = GARNET_PARAM::branching();
 
-	  current_phase = ns * (std::rand() / (RAND_MAX-1.));
+	/**
+	 * Vose's construction of the alias table of the entries [begin,end[.
+	 */
+	void build_alias(std::size_t begin, std::size_t end,
+			 std::vector<std::size_t>& small, std::vector<std::size_t>& large) {
+	  std::size_t n = end - begin;
+	  small.clear();
+	  large.clear();
+	  for(std::size_t k = 0; k < n; ++k) {
+	    alias_proba[begin+k] = proba[begin+k]*n;
+	    alias[begin+k]       = k;
+	    if(alias_proba[begin+k] < 1)
+	      small.push_back(k);
+	    else
+	      large.push_back(k);
+	  }
+	  while(!small.empty() && !large.empty()) {
+	    std::size_t l = small.back(); small.pop_back();
+	    std::size_t g = large.back(); large.pop_back();
+	    alias[begin+l] = g;
+	    alias_proba[begin+g] -= 1 - alias_proba[begin+l];
+	    if(alias_proba[begin+g] < 1)
+	      small.push_back(g);
+	    else
+	      large.push_back(g);
+	  }
+	  // What remains is 1, up to rounding errors.
+	  for(auto k : small) alias_proba[begin+k] = 1;
+	  for(auto k : large) alias_proba[begin+k] = 1;
+	}
 
-	  rewards = new reward_type[ns];
-	  memset(rewards, 0, ns*sizeof(double));
+	/**
+	 * The transitions of (s,a), for all a, and the reward of s are
+	 * drawn from a stream seeded by (seed, s), so that the garnet
+	 * does not depend on the order of the generation.
+	 */
+	void generate_state(unsigned int s, std::uint64_t seed,
+			    std::vector<char>& marked,
+			    std::vector<std::pair<unsigned int, double>>& row,
+			    std::vector<std::size_t>& small, std::vector<std::size_t>& large) {
+	  SplitMix64 gen(SplitMix64::mix(seed + SplitMix64::mix(s)));
+	  std::uniform_real_distribution<double> uniform(0, 1);
 
-	  transition_probabilities = new std::list< std::pair<unsigned int, double> >[ns*na];
+	  for(unsigned int a = 0 ; a  < na ; ++a) {
+	    // Floyd's sampling of nb distinct arrival states in [0,ns[.
+	    row.clear();
+	    for(unsigned int j = ns - nb ; j < ns ; ++j) {
+	      unsigned int t = std::uniform_int_distribution<unsigned int>(0, j)(gen);
+	      if(marked[t])
+		t = j;
+	      marked[t] = 1;
+	      row.push_back({t, 0});
+	    }
+	    for(auto& e : row)
+	      marked[e.first] = 0;
 
-	  std::vector<phase_type> next_states;
-	  next_states.clear();
-	  for(unsigned int i = 0 ; i < ns ; ++i)
-	    next_states.push_back(i);
-	  double* trans_prob = new double[nb];
+	    // The elements are sorted by increasing arrival state number.
+	    std::sort(row.begin(), row.end(),
+		      [](const std::pair<unsigned int, double>& first,
+			 const std::pair<unsigned int, double>& second) -> bool {
+			return first.first < second.first;
+		      });
 
-	  // The insertion in the transition probabilites will be sorted
-	  // we create the comparison function
-	  auto compare_elements = [](const std::pair<unsigned int, double>& first,
-				     const std::pair<unsigned int, double>& second) -> bool {
-	    return first.first < second.first;
-	  };
+	    // Generate the transition probabilities
+	    double sum = 0.0;
+	    for(auto& e : row) {
+	      e.second = uniform(gen);
+	      sum += e.second;
+	    }
 
-	  for(unsigned int s = 0 ; s < ns ; ++s) {
-	    for(unsigned int a = 0 ; a  < na ; ++a) {
-	      // Shuffle the arrival states (we will take the first nb elements)
-	      std::shuffle(next_states.begin(), next_states.end(), rd);
-	      // Generate the transition probabilities
-	      double sum = 0.0;
-	      for(unsigned int k = 0 ; k < nb ; ++k) {
-		trans_prob[k] = std::rand()/(RAND_MAX-1.);
-		sum += trans_prob[k];
-	      }
-	      for(unsigned int k = 0 ; k < nb ; ++k)
-		trans_prob[k] /= sum;
-
-	      // We now fill in the transition probabilities
-	      // the elements are sorted by increasing arrival state number
-	      for(unsigned int k = 0 ; k < nb ; ++k)
-		transition_probabilities[s*na + a].push_back(std::make_pair(next_states[k], trans_prob[k]));
-	      transition_probabilities[s*na + a].sort(compare_elements);
+	    std::size_t begin = ((std::size_t)s*na + a)*nb;
+	    offset[(std::size_t)s*na + a] = begin;
+	    for(unsigned int k = 0 ; k < nb ; ++k) {
+	      next_state[begin+k] = row[k].first;
+	      proba[begin+k]      = row[k].second / sum;
 	    }
+	    build_alias(begin, begin+nb, small, large);
 	  }
 
 	  // Generation of the reward
-	  for(unsigned int s = 0 ; s < ns ; ++s)
-	    rewards[s] = std::rand()/(RAND_MAX-1.);
+	  rewards[s] = uniform(gen);
+	}
+
+	void generate(std::uint64_t seed, unsigned int nb_threads) {
+	  if(nb > ns)
+	    throw rl::exception::Any("in rl::problem::garnet::Simulator : the branching exceeds the number of states");
+
+	  std::size_t nb_rows = (std::size_t)ns*na;
+	  rewards.assign(ns, 0);
+	  offset.resize(nb_rows+1);
+	  next_state.resize(nb_rows*nb);
+	  proba.resize(nb_rows*nb);
+	  alias_proba.resize(nb_rows*nb);
+	  alias.resize(nb_rows*nb);
+	  offset[nb_rows] = nb_rows*nb;
+
+	  rl::ThreadPool pool(nb_threads);
+	  std::vector<std::vector<char>>                                marked(pool.size());
+	  std::vector<std::vector<std::pair<unsigned int, double>>>     rows(pool.size());
+	  std::vector<std::vector<std::size_t>>                         smalls(pool.size()), larges(pool.size());
+	  pool.parallel_for(ns, [&](std::size_t s, unsigned int thread_id) {
+	      if(marked[thread_id].empty())
+		marked[thread_id].assign(ns, 0);
+	      generate_state(s, seed, marked[thread_id], rows[thread_id], smalls[thread_id], larges[thread_id]);
+	    });
+
+	  current_phase = std::uniform_int_distribution<unsigned int>(0, ns-1)(rd);
+	}
+
+      public:
+
+	/**
+	 * The garnet is generated from a seed drawn from rd.
+	 */
+	Simulator(RANDOM_ENGINE& rd) : rd(rd) {
+	  ns = GARNET_PARAM::num_states();
+	  na = GARNET_PARAM::num_actions();
+	  nb = GARNET_PARAM::branching();
+	  // The draws are sequenced, so that the seed only depends on rd.
+	  std::uint64_t high = rd();
+	  std::uint64_t low  = rd();
+	  generate((high << 32) ^ low, 1);
 	}
 
-	~Simulator(void) {
-	  delete[] rewards;
-	  delete[] transition_probabilities;
+	/**
+	 * The garnet only depends on seed, whatever the number of
+	 * threads that generate it (0 means
+	 * std::thread::hardware_concurrency()). The generation is
+	 * O(ns*na*nb log nb), so that garnets with millions of states
+	 * can be used. rd is used for the simulation.
+	 */
+	Simulator(RANDOM_ENGINE& rd, std::uint64_t seed, unsigned int nb_threads = 1) : rd(rd) {
+	  ns = GARNET_PARAM::num_states();
+	  na = GARNET_PARAM::num_actions();
+	  nb = GARNET_PARAM::branching();
+	  generate(seed, nb_threads);
 	}
 
 	const observation_type&	sense (void) const {
@@ -153,24 +277,39 @@ namespace rl {
 	    throw BadAction(ostr.str());
 	  }
 
-	  auto transition_proba = transition_probabilities[current_phase*na + a];
-	  // We have a list of arrival states with their probabilities which sum to 1
-	  double p = std::rand() / (RAND_MAX-1.);
-	  auto piter = transition_proba.begin();
-	  auto piter_end = transition_proba.end();
-	  double sum = 0.0;
-	  for(; piter != piter_end; ++piter) {
-	    sum += piter->second;
-	    if(p <= sum) 
-	      break;
-	  }
-	  current_phase = piter->first;
+	  // An entry k of the row is chosen uniformly, and then it is
+	  // either k or its alias.
+	  std::size_t begin = offset[current_phase*na + a];
+	  std::size_t n     = offset[current_phase*na + a + 1] - begin;
+	  double      x     = std::uniform_real_distribution<double>(0, n)(rd);
+	  std::size_t k     = std::min((std::size_t)x, n-1);
+	  if(x - k >= alias_proba[begin+k])
+	    k = alias[begin+k];
+	  current_phase = next_state[begin+k];
 	}
 
 	reward_type reward (void) const {
 	  return rewards[current_phase];
 	}
 
+	/**
+	 * @return the model of the garnet, for rl::dp. The reward of
+	 * (s,a) is the expected reward of the arrival state.
+	 */
+	rl::dp::Model model(void) const {
+	  rl::dp::Model m(ns, na);
+	  m.offset     = offset;
+	  m.next_state = next_state;
+	  m.proba      = proba;
+	  for(std::size_t r = 0; r < (std::size_t)ns*na; ++r) {
+	    double sum = 0;
+	    for(std::size_t k = offset[r]; k < offset[r+1]; ++k)
+	      sum += proba[k]*rewards[next_state[k]];
+	    m.reward[r] = sum;
+	  }
+	  return m;
+	}
+
 	void draw(bool verbose=true) const {
 
 	  std::ofstream outfile("graph.gv");
@@ -179,9 +318,8 @@ namespace rl {
 		  << "node [shape = circle] ; " << std::endl;
 	  for(unsigned int s = 0 ; s < ns ; ++s) {
 	    for(unsigned int a = 0 ; a < na ; ++a) {
-	      auto transition_proba = transition_probabilities[s*na+a];
-	      for(auto& tpi: transition_proba) 
-		outfile << "S" << s << " -> S" << tpi.first << " [ label = \"" << tpi.second << "\" , colorscheme=paired12, color=" << a+1 << " ];" << std::endl;
+	      for(std::size_t k = offset[s*na+a]; k < offset[s*na+a+1]; ++k)
+		outfile << "S" << s << " -> S" << next_state[k] << " [ label = \"" << proba[k] << "\" , colorscheme=paired12, color=" << a+1 << " ];" << std::endl;
 	    }
 	  }
 	  outfile <<"}" << std::endl;
@@ -217,13 +355,12 @@ namespace rl {
 	    
 	    for(unsigned int s = 0 ; s < ns ; ++s) {
 	      std::cout << std::setw(width) << std::setfill(' ') << s << " ";
-	      auto probas = transition_probabilities[s*na + a];
-	      auto probas_iter = probas.begin();
-	      auto probas_end = probas.end();
+	      std::size_t probas_iter = offset[s*na + a];
+	      std::size_t probas_end  = offset[s*na + a + 1];
 	      for(unsigned int k = 0 ; k < ns ; ++k) {
-		if(probas_iter->first == k) {
+		if(probas_iter != probas_end && next_state[probas_iter] == k) {
 		  std::cout.precision(3);
-		  std::cout << std::setw(width) << std::setfill(' ') << probas_iter->second << " ";
+		  std::cout << std::setw(width) << std::setfill(' ') << proba[probas_iter] << " ";
 		  ++probas_iter;
 		}
 		else 
@@ -31,6 +31,8 @@
 #include <sstream>
 #include <fstream>
 #include <random>
+#include <vector>
+#include <new>
 
 #include <rlAlgo.hpp>
 #include <rlException.hpp>
@@ -82,17 +84,12 @@ namespace rl {
 
                         double angle,speed;
 
+                        // Copies are the default ones, so that phases are
+                        // trivially copyable (see rl::dataset).
                         Phase(void): angle(0.0), speed(0.0) {}
-                        Phase(const Phase<param_type>& copy) : angle(copy.angle), speed(copy.speed) {}
+                        Phase(const Phase<param_type>& copy) = default;
                         Phase(double p, double s) : angle(p), speed(s) {}
-                        ~Phase(void) {}
-                        Phase<param_type>& operator=(const Phase<param_type>& copy) {
-                            if(this != &copy) {
-                                angle = copy.angle;
-                                speed = copy.speed;
-                            }
-                            return *this;
-                        }
+                        Phase<param_type>& operator=(const Phase<param_type>& copy) = default;
 
                         void check(std::string message) const {
                             if(fabs(angle) > M_PI_2) {
@@ -112,6 +109,10 @@ namespace rl {
 
                 };
 
+            template<typename INVERTED_PENDULUM_PARAM,
+                typename RANDOM_GENERATOR>
+                    class BatchSimulator;
+
             /**
              * Inverted pendulum simulator  
              * @author <a href="mailto:Herve.Frezza-Buet@supelec.fr">Herve.Frezza-Buet@supelec.fr</a>
@@ -148,6 +149,8 @@ namespace rl {
                                     static double aml(void)      {return a()*m()*l();}
                             };
 
+                            friend class BatchSimulator<INVERTED_PENDULUM_PARAM,RANDOM_GENERATOR>;
+
                         public:
 
                             Simulator(RANDOM_GENERATOR& generator) : current_state(), r(0), gen(generator()) {}
@@ -166,7 +169,11 @@ namespace rl {
                                 return current_state;
                             }
 
-                            void timeStep(const action_type& a) {
+                            /**
+                             * This is the exception-free transition.
+                             * @return true if a terminal state is reached.
+                             */
+                            bool timeStep(const action_type& a, std::nothrow_t) {
                                 double aa;
                                 double acc,cphi;
 
@@ -200,9 +207,15 @@ namespace rl {
 
                                 if(fabs(current_state.angle)>M_PI_2) {
                                     r = -1;
-                                    throw rl::exception::Terminal("Pendulum has fallen down");
+                                    return true;
                                 }
                                 r = 0;
+                                return false;
+                            }
+
+                            void timeStep(const action_type& a) {
+                                if(timeStep(a,std::nothrow))
+                                    throw rl::exception::Terminal("Pendulum has fallen down");
                             }
 
                             reward_type reward(void) const {
@@ -210,6 +223,155 @@ namespace rl {
                             }
 
                     };
+
+            /**
+             * @short Inverted pendulum simulator running a batch of
+             * independent phases at once.
+             *
+             * The phases are stored as a structure of arrays (angles
+             * and speeds), so that the transition of all the lanes is
+             * computed by a single loop that the compiler can
+             * vectorize. A lane that reaches a terminal state is
+             * automatically restarted around the equilibrium, its
+             * terminal flag being raised for the current time step.
+             *
+             * The transition of a lane is computed as in Simulator.
+             * Nevertheless, the action noise of all the lanes and the
+             * restart phases are drawn from the single generator of
+             * the batch, so a lane only follows the trajectory of a
+             * Simulator set in the same phase when
+             * param_type::actionNoise() is null.
+             */
+            template<typename INVERTED_PENDULUM_PARAM,
+                typename RANDOM_GENERATOR>
+                    class BatchSimulator {
+
+                        public:
+
+                            using param_type = INVERTED_PENDULUM_PARAM;
+
+                            using       phase_type = Phase<param_type>;
+                            using observation_type = phase_type;
+                            using    action_type = Action;
+                            using    reward_type = double;
+
+                        private:
+
+                            using Param = typename Simulator<INVERTED_PENDULUM_PARAM,RANDOM_GENERATOR>::Param;
+
+                            std::vector<double>        angles;
+                            std::vector<double>        speeds;
+                            std::vector<double>        forces;
+                            std::vector<reward_type>   rewards;
+                            std::vector<unsigned char> terminals;
+                            RANDOM_GENERATOR gen;
+
+                        public:
+
+                            BatchSimulator(unsigned int nb_lanes, RANDOM_GENERATOR& generator)
+                                : angles(nb_lanes), speeds(nb_lanes), forces(nb_lanes),
+                                rewards(nb_lanes,0), terminals(nb_lanes,0), gen(generator()) {
+                                    for(unsigned int i = 0; i < nb_lanes; ++i)
+                                        restart(i);
+                                }
+                            BatchSimulator(const BatchSimulator& copy)       = delete;
+                            BatchSimulator& operator=(const BatchSimulator&) = delete;
+
+                            unsigned int size(void) const {
+                                return angles.size();
+                            }
+
+                            /**
+                             * This sets a random phase around the equilibrium in the lane.
+                             */
+                            void restart(unsigned int lane) {
+                                phase_type s;
+                                s.random(gen);
+                                setPhase(lane,s);
+                            }
+
+                            void setPhase(unsigned int lane, const phase_type& s) {
+                                s.check("in BatchSimulator::setPhase");
+                                angles[lane] = s.angle;
+                                speeds[lane] = s.speed;
+                            }
+
+                            observation_type sense(unsigned int lane) const {
+                                return phase_type(angles[lane],speeds[lane]);
+                            }
+
+                            const double* angle(void) const {return angles.data();}
+                            const double* speed(void) const {return speeds.data();}
+
+                            /**
+                             * This performs a transition for each lane.
+                             * @param actions actions[i] is the action performed in lane i.
+                             */
+                            void timeStep(const action_type* actions) {
+                                unsigned int i;
+                                unsigned int n = size();
+                                std::uniform_real_distribution<> dis(-param_type::actionNoise(), param_type::actionNoise());
+
+                                for(i = 0; i < n; ++i) {
+                                    double aa;
+                                    switch(actions[i]) {
+                                        case Action::actionRight:
+                                            aa = 1;
+                                            break;
+                                        case Action::actionLeft: 
+                                            aa = -1;
+                                            break;
+                                        case Action::actionNone:
+                                            aa = 0;
+                                            break;
+                                        default:
+                                            std::ostringstream ostr;
+                                            ostr << "inverted_pendulum::BatchSimulator::timeStep(" << static_cast<int>(actions[i]) << ")";
+                                            throw BadAction(ostr.str());
+                                    }
+                                    forces[i] = (aa + dis(gen))*Param::strength();
+                                }
+
+                                double* phi = angles.data();
+                                double* v   = speeds.data();
+                                double* f   = forces.data();
+                                double* r   = rewards.data();
+                                unsigned char* t = terminals.data();
+                                for(i = 0; i < n; ++i) {
+                                    double cphi = cos(phi[i]);
+                                    double acc  = ( Param::g()*sin(phi[i]) 
+                                            - .5*Param::aml()*sin(2*phi[i])*v[i]*v[i] 
+                                            - Param::a()*cphi*f[i] )
+                                        / ( 4*Param::l()/3.0 - Param::aml()*cphi*cphi );
+                                    phi[i] += v[i]*Param::tau();
+                                    v[i]   += acc*Param::tau();
+                                    bool fallen = fabs(phi[i]) > M_PI_2;
+                                    r[i] = fallen ? -1 : 0;
+                                    t[i] = fallen;
+                                }
+
+                                for(i = 0; i < n; ++i)
+                                    if(t[i])
+                                        restart(i);
+                            }
+
+                            /**
+                             * @return rewards such as reward()[i] is the reward of the last transition in lane i.
+                             */
+                            const reward_type* reward(void) const {
+                                return rewards.data();
+                            }
+
+                            /**
+                             * @return flags such as terminal()[i] is non null
+                             * if the last transition in lane i has reached a
+                             * terminal state. In this case, the lane has been
+                             * restarted.
+                             */
+                            const unsigned char* terminal(void) const {
+                                return terminals.data();
+                            }
+                    };
         }
     }
 }
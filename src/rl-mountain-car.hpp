@@ -35,6 +35,9 @@
 #include <vector>
 #include <iterator>
 #include <utility>
+#include <algorithm>
+#include <random>
+#include <new>
 #include <rlAlgo.hpp>
 #include <rlEpisode.hpp>
 #include <rlException.hpp>
@@ -87,17 +90,12 @@ namespace rl {
 
                         double position,speed;
 
+                        // Copies are the default ones, so that phases are
+                        // trivially copyable (see rl::dataset).
                         Phase(void) {}
-                        Phase(const Phase& copy) : position(copy.position), speed(copy.speed) {}
+                        Phase(const Phase& copy) = default;
                         Phase(double p, double s) : position(p), speed(s) {}
-                        ~Phase(void) {}
-                        Phase& operator=(const Phase& copy) {
-                            if(this != &copy) {
-                                position = copy.position;
-                                speed    = copy.speed;
-                            }
-                            return *this;
-                        }
+                        Phase& operator=(const Phase& copy) = default;
 
                         void check(void) const {
                             if( (position > param_type::maxPosition()) || (position < param_type::minPosition())
@@ -173,7 +171,11 @@ namespace rl {
                             return current_state;
                         }
 
-                        void timeStep(const action_type& a) {
+                        /**
+                         * This is the exception-free transition.
+                         * @return true if a terminal state is reached.
+                         */
+                        bool timeStep(const action_type& a, std::nothrow_t) {
                             double aa;
 
                             switch(a) {
@@ -205,14 +207,18 @@ namespace rl {
 
                                 if((current_state.speed >= param_type::goalSpeed()) 
                                         && 
-                                        (current_state.speed <= param_type::goalSpeed() + param_type::goalSpeedMargin())) {
+                                        (current_state.speed <= param_type::goalSpeed() + param_type::goalSpeedMargin()))
                                     r = param_type::rewardGoal();
-                                    throw rl::exception::Terminal("Goal reached");
-                                }
 
-                                throw rl::exception::Terminal("Upper position bound violated");
+                                return true;
                             }
 
+                            return false;
+                        }
+
+                        void timeStep(const action_type& a) {
+                            if(timeStep(a,std::nothrow))
+                                throw rl::exception::Terminal("Upper position bound reached");
                         }
 
                         reward_type reward(void) const {
@@ -232,6 +238,147 @@ namespace rl {
                         }
                 };
 
+            /**
+             * @short Mountain car simulator running a batch of
+             * independent phases at once. 
+             *
+             * The phases are stored as a structure of arrays (positions
+             * and speeds), so that the transition of all the lanes is
+             * computed by a single loop that the compiler can
+             * vectorize. A lane that reaches a terminal state is
+             * automatically restarted from a random phase, its terminal
+             * flag being raised for the current time step.
+             *
+             * The transition of a lane is computed as in Simulator,
+             * which is deterministic, so a lane follows the trajectory
+             * of a Simulator set in the same phase until it is
+             * restarted.
+             */
+            template<typename MOUNTAIN_CAR_PARAM,
+                typename RANDOM_GENERATOR>
+                class BatchSimulator {
+
+                    public:
+
+                        using param_type = MOUNTAIN_CAR_PARAM;
+
+                        using       phase_type = Phase<param_type>;
+                        using observation_type = phase_type;
+                        using      action_type = Action;
+                        using      reward_type = double;
+
+                    private:
+
+                        std::vector<double>        positions;
+                        std::vector<double>        speeds;
+                        std::vector<double>        accelerations;
+                        std::vector<reward_type>   rewards;
+                        std::vector<unsigned char> terminals;
+                        RANDOM_GENERATOR gen;
+
+                    public:
+
+                        BatchSimulator(unsigned int nb_lanes, RANDOM_GENERATOR& generator) 
+                            : positions(nb_lanes), speeds(nb_lanes), accelerations(nb_lanes),
+                            rewards(nb_lanes,0), terminals(nb_lanes,0), gen(generator()) {
+                                for(unsigned int i = 0; i < nb_lanes; ++i)
+                                    restart(i);
+                            }
+                        BatchSimulator(const BatchSimulator& copy)       = delete;
+                        BatchSimulator& operator=(const BatchSimulator&) = delete;
+
+                        unsigned int size(void) const {
+                            return positions.size();
+                        }
+
+                        /**
+                         * This sets a random phase in the lane.
+                         */
+                        void restart(unsigned int lane) {
+                            setPhase(lane,phase_type::random(gen));
+                        }
+
+                        void setPhase(unsigned int lane, const phase_type& s) {
+                            s.check();
+                            positions[lane] = s.position;
+                            speeds[lane]    = s.speed;
+                        }
+
+                        observation_type sense(unsigned int lane) const {
+                            return phase_type(positions[lane],speeds[lane]);
+                        }
+
+                        const double* position(void) const {return positions.data();}
+                        const double* speed(void)    const {return speeds.data();}
+
+                        /**
+                         * This performs a transition for each lane.
+                         * @param actions actions[i] is the action performed in lane i.
+                         */
+                        void timeStep(const action_type* actions) {
+                            unsigned int i;
+                            unsigned int n = size();
+
+                            for(i = 0; i < n; ++i)
+                                switch(actions[i]) {
+                                    case Action::actionForward:
+                                        accelerations[i] =  .001;
+                                        break;
+                                    case Action::actionBackward: 
+                                        accelerations[i] = -.001;
+                                        break;
+                                    case Action::actionNone:
+                                        accelerations[i] =    0;
+                                        break;
+                                    default:
+                                        std::ostringstream ostr;
+                                        ostr << "mountain_car::BatchSimulator::timeStep(" << static_cast<int>(actions[i]) << ")";
+                                        throw BadAction(ostr.str());
+                                }
+
+                            double* p   = positions.data();
+                            double* v   = speeds.data();
+                            double* acc = accelerations.data();
+                            double* r   = rewards.data();
+                            unsigned char* t = terminals.data();
+                            for(i = 0; i < n; ++i) {
+                                double speed    = v[i] + (acc[i] - 0.0025*cos(3*p[i]));
+                                speed           = std::min(std::max(speed,param_type::minSpeed()),param_type::maxSpeed());
+                                double position = p[i] + speed;
+                                bool   below    = position < param_type::minPosition();
+                                bool   above    = position > param_type::maxPosition();
+                                bool   goal     = above
+                                    && (speed >= param_type::goalSpeed()) 
+                                    && (speed <= param_type::goalSpeed() + param_type::goalSpeedMargin());
+                                p[i] = below ? param_type::minPosition() : position;
+                                v[i] = below ? 0 : speed;
+                                r[i] = goal ? param_type::rewardGoal() : param_type::rewardStep();
+                                t[i] = above;
+                            }
+
+                            for(i = 0; i < n; ++i)
+                                if(t[i])
+                                    restart(i);
+                        }
+
+                        /**
+                         * @return rewards such as reward()[i] is the reward of the last transition in lane i.
+                         */
+                        const reward_type* reward(void) const {
+                            return rewards.data();
+                        }
+
+                        /**
+                         * @return flags such as terminal()[i] is non null
+                         * if the last transition in lane i has reached a
+                         * terminal state. In this case, the lane has been
+                         * restarted.
+                         */
+                        const unsigned char* terminal(void) const {
+                            return terminals.data();
+                        }
+                };
+
             /**
              * @short This plots nice graphics for representing the Q function.
              * @param rank use a negative rank to avoid ranks in file names.
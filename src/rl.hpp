@@ -30,16 +30,24 @@
 #include <cmath>
 
 #include <rlAlgo.hpp>       
+#include <rlDP.hpp>
+#include <rlDataset.hpp>
 #include <rlEpisode.hpp> 
 #include <rlException.hpp>
 #include <rlKTD.hpp>
 #include <rlLSTD.hpp>
+#include <rlLinearKTD.hpp>
+#include <rlLinearQ.hpp>
 #include <rlMLP.hpp>
 #include <rlOffPAPI.hpp>
 #include <rlPolicy.hpp>
 #include <rlQLearning.hpp>
 #include <rlSARSA.hpp>
+#include <rlSnapshot.hpp>
+#include <rlSparse.hpp>
 #include <rlTD.hpp>
+#include <rlThreadPool.hpp>
+#include <rlTileCoding.hpp>
 #include <rlActorCritic.hpp>
 #include <rlTypes.hpp>
 
@@ -76,6 +84,14 @@
  * @example example-001-002-cliff-walking-qlearning.cc
  */
 
+/**
+ * @example example-001-003-cliff-walking-linear-ktdsarsa.cc
+ */
+
+/**
+ * @example example-001-004-cliff-walking-parallel-sarsa.cc
+ */
+
 
 /**
  * @example example-002-001-boyan-lstd.cc
@@ -85,6 +101,10 @@
  * @example example-002-002-pendulum-lspi.cc
  */
 
+/**
+ * @example example-002-003-pendulum-lspi-dataset.cc
+ */
+
 /**
  * @example example-003-001-pendulum-ktdq.cc
  */
@@ -97,6 +117,10 @@
  * @example example-003-003-mountain-car-ktdsarsa.cc
  */
 
+/**
+ * @example example-003-005-mountain-car-tiles-sarsa.cc
+ */
+
 /**
  * @example example-004-001-cliff-onestep.cc
  */
@@ -105,6 +129,10 @@
  * @example example-004-002-cliff-eligibility.cc
  */
 
+/**
+ * @example example-005-001-dynamic-programming.cc
+ */
+
 /**
  * @example example-defs-transition.hpp
  */
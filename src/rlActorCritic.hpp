@@ -206,6 +206,24 @@ namespace rl {
                                 return _actor(_state_to_idx(s));
                             }
 
+                            /**
+                             * This adds the critic and actor
+                             * parameters, and the softmax temperature,
+                             * to a binary snapshot, names being
+                             * prefixed by prefix.
+                             */
+                            void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                                writer.add(prefix + "critic",      _critic._params);
+                                writer.add(prefix + "actor",       _actor._params);
+                                writer.add(prefix + "temperature", _actor.temperature);
+                            }
+
+                            void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                                mapping.copy(prefix + "critic", _critic._params);
+                                mapping.copy(prefix + "actor",  _actor._params);
+                                _actor.temperature = mapping.scalar(prefix + "temperature");
+                            }
+
                     };
             }
 
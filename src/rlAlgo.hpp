@@ -35,10 +35,15 @@
 #include <iostream>
 #include <limits>
 #include <random>
-#include <map>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
 
 #include <gsl/gsl_vector.h>
 
+#include <rlTraits.hpp>
+#include <rlSparse.hpp>
+
 namespace rl {
 
   template<typename ITERATOR,
@@ -209,10 +214,48 @@ namespace rl {
 
   namespace random {
 
+    /**
+     * The samplers below store one value per candidate in a buffer
+     * allocated on the stack, if there are at most this number of
+     * candidates. Otherwise, a buffer owned by the calling thread is
+     * used (it is only reallocated when it has to grow).
+     */
+    constexpr std::size_t sampling_stack_size = 64;
+
+    inline double* _sampling_buffer(std::size_t size, double* stack_buffer) {
+      if(size <= sampling_stack_size)
+	return stack_buffer;
+      static thread_local std::vector<double> heap_buffer;
+      if(heap_buffer.size() < size)
+	heap_buffer.resize(size);
+      return heap_buffer.data();
+    }
+
+    /**
+     * @param cumul The cumulative sums of the weights.
+     * @return the index k of the draw, with a single uniform draw.
+     */
+    template<typename RANDOM_DEVICE>
+    std::size_t _cumulative_draw(const double* cumul, std::size_t size,
+				 RANDOM_DEVICE& rd) {
+      double sum = cumul[size-1];
+      if(!(sum > 0))
+	return std::uniform_int_distribution<std::size_t>(0,size-1)(rd);
+      double u = std::uniform_real_distribution<double>(0,sum)(rd);
+      for(std::size_t k = 0; k < size; ++k)
+	if(u < cumul[k])
+	  return k;
+      // Rounding errors may lead here, let us return the last non-null weight.
+      std::size_t k = size-1;
+      while(k > 0 && cumul[k-1] == cumul[k])
+	--k;
+      return k;
+    }
     
     /**
      * @return A random value according to the histogram represented
-     * by f(x), for x in [begin,end[.
+     * by f(x), for x in [begin,end[. f is evaluated once per value,
+     * negative values are considered as null.
      */
     template<typename ITERATOR,
         typename fctEVAL,
@@ -221,19 +264,24 @@ namespace rl {
                     const ITERATOR& begin, const ITERATOR& end,
                     RANDOM_DEVICE& rd) 
             -> decltype(*begin) {
-                auto size = end-begin;
-                std::vector<double> fvalues(size);
-                auto iter = begin;
-                auto fvaluesiter = fvalues.begin();
-                for(; iter != end; ++iter, ++fvaluesiter)
-                    *fvaluesiter = f(*iter);
-                std::discrete_distribution<decltype(end - begin)> d(fvalues.begin(), fvalues.end());
-                return *(begin + d(rd));
-
+                std::size_t size = end-begin;
+                double  stack_buffer[sampling_stack_size];
+                double* cumul = _sampling_buffer(size,stack_buffer);
+                double  sum   = 0;
+                std::size_t k = 0;
+                for(auto iter = begin; iter != end; ++iter, ++k) {
+                    double v = f(*iter);
+                    if(v > 0)
+                        sum += v;
+                    cumul[k] = sum;
+                }
+                return *(begin + _cumulative_draw(cumul,size,rd));
             }
 
     /**
-     * @return true with a probability proba
+     * @return A random value x in [begin,end[, with a probability
+     * proportional to exp(f(x)/temperature). f is evaluated once per
+     * value.
      */
 
     template<typename ITERATOR,
@@ -244,20 +292,88 @@ namespace rl {
 		 const ITERATOR& begin, const ITERATOR& end, 
          RANDOM_DEVICE& rd) 
       -> decltype(*begin) {
+          std::size_t size = end-begin;
+          double  stack_buffer[sampling_stack_size];
+          double* values = _sampling_buffer(size,stack_buffer);
+          double  fmax   = std::numeric_limits<double>::lowest();
+          std::size_t k  = 0;
+          for(auto it = begin; it != end; ++it, ++k) {
+              values[k] = f(*it);
+              fmax = std::max(fmax, values[k]);
+          }
 
-          std::map<const decltype(*begin), double> f_values;
-          double fmax = std::numeric_limits<double>::lowest();
-          for(auto it = begin; it != end; ++it) {
-              f_values[*it] = f(*it);
-              fmax = std::max(fmax, f_values[*it]);
+          // values are replaced by the cumulative sums of the shifted exponentials.
+          double sum = 0;
+          for(k = 0; k < size; ++k) {
+              sum += exp((values[k] - fmax)/temperature);
+              values[k] = sum;
           }
 
-          auto shifted_exp_values = [&temperature, &f_values, &fmax](const decltype(*begin)& a) -> double {
-            return exp((f_values[a] - fmax)/temperature);
-          };
+      return *(begin + _cumulative_draw(values,size,rd));
+    }
 
-      return rl::random::density(shifted_exp_values, begin,end, rd);
+    /**
+     * This is the softmax draw from a state-action value function
+     * q(s,a). If q provides q.q_all(s,values) (see
+     * rl::traits::has_q_all), all the values are obtained from a
+     * single call.
+     * @return A random action a in [begin,end[, with a probability
+     * proportional to exp(q(s,a)/temperature).
+     */
+    template<typename Q,
+	     typename STATE,
+	     typename ITERATOR,
+	     typename RANDOM_DEVICE>
+    auto softmax(const Q& q, const STATE& s,
+		 double temperature,
+		 const ITERATOR& begin, const ITERATOR& end, 
+		 RANDOM_DEVICE& rd) 
+      -> decltype(*begin) {
+      if constexpr (rl::traits::has_q_all<Q, STATE>::value) {
+	std::size_t size = end-begin;
+	double  stack_buffer[sampling_stack_size];
+	double* values = _sampling_buffer(size,stack_buffer);
+	q.q_all(s,values);
+	double fmax = *std::max_element(values, values+size);
+	double sum  = 0;
+	for(std::size_t k = 0; k < size; ++k) {
+	  sum += exp((values[k] - fmax)/temperature);
+	  values[k] = sum;
+	}
+	return *(begin + _cumulative_draw(values,size,rd));
+      }
+      else
+	return rl::random::softmax(std::bind(q, s, std::placeholders::_1), temperature, begin, end, rd);
+    }
+  }
+
+  /**
+   * This is the argmax of a state-action value function q(s,a) for a
+   * given state s. If q provides q.q_all(s,values) (see
+   * rl::traits::has_q_all), all the values are obtained from a
+   * single call, rather than from one call of q(s,a) per action.
+   */
+  template<typename Q,
+	   typename STATE,
+	   typename ITERATOR>
+  auto argmax(const Q& q, const STATE& s,
+	      const ITERATOR& begin, 
+	      const ITERATOR& end)
+    -> std::pair<decltype(*begin),
+		 decltype(q(s,*begin))> {
+    if constexpr (rl::traits::has_q_all<Q, STATE>::value) {
+      std::size_t size = end-begin;
+      double  stack_buffer[rl::random::sampling_stack_size];
+      double* values = rl::random::_sampling_buffer(size,stack_buffer);
+      q.q_all(s,values);
+      std::size_t k_max = 0;
+      for(std::size_t k = 1; k < size; ++k)
+	if(values[k] > values[k_max])
+	  k_max = k;
+      return {*(begin + k_max), values[k_max]};
     }
+    else
+      return rl::argmax(std::bind(q, s, std::placeholders::_1), begin, end);
   }
 
 
@@ -284,6 +400,11 @@ namespace rl {
       auto gradvparam_of_gradqparam(const Q& gq) -> std::function<void (const gsl_vector*,gsl_vector*,Pair<S,A>)> {
 	return [&gq](const gsl_vector* theta, gsl_vector* grad, const Pair<S,A>& sa) -> void {gq(theta,grad,sa.s,sa.a);};
       }
+      // This rewrites grad_q(theta,sparse_grad,s,a) as v(theta,sparse_grad,(s,a)), for rl::sparse_lstd.
+      template<typename S, typename A, typename REWARD, typename Q>
+      auto sparse_gradvparam_of_gradqparam(const Q& gq) -> std::function<void (const gsl_vector*,rl::gsl::SparseVector&,Pair<S,A>)> {
+	return [&gq](const gsl_vector* theta, rl::gsl::SparseVector& grad, const Pair<S,A>& sa) -> void {gq(theta,grad,sa.s,sa.a);};
+      }
     }
   }
 }
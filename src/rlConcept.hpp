@@ -24,6 +24,8 @@
  *
  */
 
+#include <new>
+
 namespace rl {
 
 
@@ -59,6 +61,15 @@ namespace rl {
        */
       void timeStep(const ACTION& a);
 
+      /**
+       * This is optional. It does the same as timeStep(a), except
+       * that reaching a terminal state is notified by returning true
+       * rather than by raising rl::exception::Terminal. When it is
+       * provided, the rl::episode functions use it, which avoids the
+       * cost of exception handling at the end of each episode.
+       */
+      bool timeStep(const ACTION& a, std::nothrow_t);
+
       /**
        * This gives the reward obtained from the last phase transition.
        */
@@ -0,0 +1,319 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <gsl/gsl_vector.h>
+
+#include <rlException.hpp>
+#include <rlSparse.hpp>
+#include <rlThreadPool.hpp>
+
+namespace rl {
+
+  /**
+   * @short Exact dynamic programming for finite MDPs.
+   *
+   * The solvers work on a rl::dp::Model, that the tabular problems
+   * provide (see rl::problem::garnet::Simulator::model and
+   * rl::problem::cliff_walking::model). They are meant to compute
+   * the ground truth (V*, Q*, V^pi) that approximate learners can be
+   * compared to.
+   */
+  namespace dp {
+
+    /**
+     * @short A finite MDP, with its transitions stored row-wise.
+     *
+     * States are in [0,nb_states[ and actions in [0,nb_actions[. The
+     * row of (s,a) is row(s,a) = s*nb_actions+a. Its arrival states are
+     * next_state[k], with probability proba[k], for k in
+     * [offset[row],offset[row+1][, and reward[row] is the expected
+     * reward of doing a in s. The probabilities of a row may sum to
+     * less than 1, the missing mass being the probability that the
+     * episode ends. A terminal state has empty rows.
+     */
+    class Model {
+    public:
+
+      unsigned int              nb_states;
+      unsigned int              nb_actions;
+      std::vector<std::size_t>  offset;
+      std::vector<unsigned int> next_state;
+      std::vector<double>       proba;
+      std::vector<double>       reward;
+
+      Model(void) : Model(0, 0) {}
+      
+      /**
+       * This makes a model with empty rows and null rewards.
+       */
+      Model(unsigned int ns, unsigned int na)
+	: nb_states(ns), nb_actions(na),
+	  offset((std::size_t)ns*na+1, 0), next_state(), proba(),
+	  reward((std::size_t)ns*na, 0) {}
+
+      std::size_t row(unsigned int s, unsigned int a) const {
+	return (std::size_t)s*nb_actions + a;
+      }
+
+      /**
+       * @return reward(s,a) + gamma * sum_s' p(s'|s,a) value_of(s').
+       */
+      template<typename fctVALUE>
+      double backup(std::size_t r, double gamma, const fctVALUE& value_of) const {
+	double sum = 0;
+	for(std::size_t k = offset[r]; k < offset[r+1]; ++k)
+	  sum += proba[k]*value_of(next_state[k]);
+	return reward[r] + gamma*sum;
+      }
+    };
+
+    /**
+     * The order of the updates in the iterative solvers. With
+     * jacobi, a sweep computes all the new values from the previous
+     * ones, so that the result does not depend on the number of
+     * threads. With gauss_seidel, the values are updated in place,
+     * each update using the freshest values, which usually
+     * converges in fewer sweeps. With several threads, each one
+     * sweeps its own block of states in place, using the values
+     * of the other blocks from the previous sweep.
+     */
+    enum class Sweep {jacobi, gauss_seidel};
+
+    /**
+     * This runs sweeps of V(s) <- update(s, value_of) until the
+     * largest change is below tol, or max_iter sweeps are done.
+     * @return the number of sweeps.
+     */
+    template<typename fctUPDATE>
+    std::size_t _sweeps(std::vector<double>& V,
+			double tol, std::size_t max_iter,
+			Sweep sweep, rl::ThreadPool& pool,
+			const fctUPDATE& update) {
+      std::size_t n  = V.size();
+      std::size_t nb = pool.size();
+      std::vector<double> V_old(V);
+      std::vector<double> delta(nb);
+      std::size_t iter = 0;
+
+      while(iter < max_iter) {
+	++iter;
+	pool.run([&](unsigned int thread_id) {
+	    std::size_t first = (n * thread_id)     / nb;
+	    std::size_t last  = (n * (thread_id+1)) / nb;
+	    double d = 0;
+	    if(sweep == Sweep::jacobi) {
+	      auto value_of = [&V_old](unsigned int s) {return V_old[s];};
+	      for(std::size_t s = first; s < last; ++s) {
+		V[s] = update(s, value_of);
+		d = std::max(d, std::fabs(V[s] - V_old[s]));
+	      }
+	    }
+	    else {
+	      auto value_of = [&V, &V_old, first, last](unsigned int s) {
+		return (s >= first && s < last) ? V[s] : V_old[s];
+	      };
+	      for(std::size_t s = first; s < last; ++s) {
+		double v = update(s, value_of);
+		d = std::max(d, std::fabs(v - V[s]));
+		V[s] = v;
+	      }
+	    }
+	    delta[thread_id] = d;
+	  });
+	std::copy(V.begin(), V.end(), V_old.begin());
+	if(*std::max_element(delta.begin(), delta.end()) <= tol)
+	  break;
+      }
+      return iter;
+    }
+
+    /**
+     * This computes the optimal values V*, starting from the
+     * content of V (resized to nb_states, if needed). The sweeps stop
+     * when no value changes by more than tol, so that V is then
+     * within tol*gamma/(1-gamma) of V* when gamma < 1.
+     * @param nb_threads 0 means std::thread::hardware_concurrency().
+     * @return the number of sweeps.
+     */
+    inline std::size_t value_iteration(const Model& m, double gamma,
+				       std::vector<double>& V,
+				       double tol, std::size_t max_iter,
+				       Sweep sweep = Sweep::gauss_seidel,
+				       unsigned int nb_threads = 1) {
+      V.resize(m.nb_states, 0);
+      rl::ThreadPool pool(nb_threads);
+      return _sweeps(V, tol, max_iter, sweep, pool,
+		     [&m, gamma](std::size_t s, const auto& value_of) {
+		       double best = m.backup(m.row(s, 0), gamma, value_of);
+		       for(unsigned int a = 1; a < m.nb_actions; ++a)
+			 best = std::max(best, m.backup(m.row(s, a), gamma, value_of));
+		       return best;
+		     });
+    }
+
+    /**
+     * This computes V^pi, pi being given by policy[s], iteratively,
+     * starting from the content of V.
+     * @return the number of sweeps.
+     */
+    inline std::size_t policy_evaluation(const Model& m, double gamma,
+					 const std::vector<unsigned int>& policy,
+					 std::vector<double>& V,
+					 double tol, std::size_t max_iter,
+					 Sweep sweep = Sweep::gauss_seidel,
+					 unsigned int nb_threads = 1) {
+      V.resize(m.nb_states, 0);
+      rl::ThreadPool pool(nb_threads);
+      return _sweeps(V, tol, max_iter, sweep, pool,
+		     [&m, &policy, gamma](std::size_t s, const auto& value_of) {
+		       return m.backup(m.row(s, policy[s]), gamma, value_of);
+		     });
+    }
+
+    /**
+     * This computes V^pi by solving (I - gamma P_pi).V = r_pi with
+     * rl::gsl::bicgstab, the matrix being sparse. V is the initial
+     * guess. If gamma is 1, pi must end the episodes with probability
+     * 1 from any state, otherwise the system is singular.
+     * @return the number of solver iterations.
+     * @throw rl::exception::NotConverged if the relative residual is
+     * still above tol after max_iter iterations.
+     */
+    inline std::size_t exact_policy_evaluation(const Model& m, double gamma,
+					       const std::vector<unsigned int>& policy,
+					       std::vector<double>& V,
+					       double tol = 1e-12, std::size_t max_iter = 10000) {
+      std::size_t n = m.nb_states;
+      V.resize(n, 0);
+      rl::gsl::SparseMatrix A(n, n);
+      gsl_vector* r = gsl_vector_alloc(n);
+      for(std::size_t s = 0; s < n; ++s) {
+	std::size_t row = m.row(s, policy[s]);
+	A.add(s, s, 1);
+	for(std::size_t k = m.offset[row]; k < m.offset[row+1]; ++k)
+	  A.add(s, m.next_state[k], -gamma*m.proba[k]);
+	gsl_vector_set(r, s, m.reward[row]);
+      }
+      A.compress();
+      gsl_vector_view v = gsl_vector_view_array(V.data(), n);
+      bool converged;
+      std::size_t nb_iter = rl::gsl::bicgstab(A, r, &(v.vector), tol, max_iter, converged);
+      gsl_vector_free(r);
+      if(!converged)
+	throw rl::exception::NotConverged(std::string("rl::dp::exact_policy_evaluation, after ")
+					  + std::to_string(nb_iter) + " iterations");
+      return nb_iter;
+    }
+
+    /**
+     * Q[row(s,a)] <- reward(s,a) + gamma * sum_s' p(s'|s,a) V(s').
+     */
+    inline void q_values(const Model& m, double gamma,
+			 const std::vector<double>& V,
+			 std::vector<double>& Q,
+			 unsigned int nb_threads = 1) {
+      Q.resize((std::size_t)m.nb_states*m.nb_actions);
+      auto value_of = [&V](unsigned int s) {return V[s];};
+      rl::ThreadPool pool(nb_threads);
+      pool.parallel_for(Q.size(), [&](std::size_t r, unsigned int) {
+	  Q[r] = m.backup(r, gamma, value_of);
+	});
+    }
+
+    /**
+     * policy[s] <- argmax_a Q(s,a), Q being obtained from V. A
+     * former action of policy is kept unless another one is better
+     * by more than eps, so that ties do not make policy iteration
+     * cycle.
+     * @return the number of states whose action has changed.
+     */
+    inline std::size_t greedy(const Model& m, double gamma,
+			      const std::vector<double>& V,
+			      std::vector<unsigned int>& policy,
+			      unsigned int nb_threads = 1,
+			      double eps = 1e-12) {
+      policy.resize(m.nb_states, 0);
+      auto value_of = [&V](unsigned int s) {return V[s];};
+      rl::ThreadPool pool(nb_threads);
+      std::vector<std::size_t> changes(pool.size(), 0);
+      pool.parallel_for(m.nb_states, [&](std::size_t s, unsigned int thread_id) {
+	  unsigned int best   = policy[s];
+	  double       q_best = m.backup(m.row(s, best), gamma, value_of);
+	  double       q_old  = q_best;
+	  for(unsigned int a = 0; a < m.nb_actions; ++a) {
+	    double q = m.backup(m.row(s, a), gamma, value_of);
+	    if(q > q_best) {
+	      q_best = q;
+	      best   = a;
+	    }
+	  }
+	  if(best != policy[s] && q_best > q_old + eps*std::max(1.0, std::fabs(q_old))) {
+	    policy[s] = best;
+	    ++changes[thread_id];
+	  }
+	});
+      std::size_t res = 0;
+      for(auto c : changes)
+	res += c;
+      return res;
+    }
+
+    /**
+     * This is policy iteration, starting from policy (resized to
+     * nb_states, with action 0 for the new states, if needed). Each
+     * policy is evaluated by exact_policy_evaluation, and then
+     * improved greedily, until it is stable. policy and V are then
+     * optimal. With gamma = 1, all the policies met must end the
+     * episodes (see exact_policy_evaluation), the initial one
+     * included. Otherwise, the evaluation does not converge and
+     * rl::exception::NotConverged is thrown.
+     * @return the number of improvement steps.
+     */
+    inline std::size_t policy_iteration(const Model& m, double gamma,
+					std::vector<unsigned int>& policy,
+					std::vector<double>& V,
+					std::size_t max_iter,
+					unsigned int nb_threads = 1,
+					double tol = 1e-12) {
+      policy.resize(m.nb_states, 0);
+      std::size_t iter = 0;
+      while(iter < max_iter) {
+	++iter;
+	exact_policy_evaluation(m, gamma, policy, V, tol);
+	if(greedy(m, gamma, V, policy, nb_threads) == 0)
+	  break;
+      }
+      return iter;
+    }
+  }
+}
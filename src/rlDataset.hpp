@@ -0,0 +1,482 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <rlException.hpp>
+
+namespace rl {
+
+    /**
+     * @short On-disk transition datasets, for out-of-core batch algorithms.
+     *
+     * A dataset is stored column by column, in six files: path.s,
+     * path.a, path.r, path.s_, path.a_ and path.terminal, for s, a,
+     * r, s', a' and the terminal flag of each transition. Each file
+     * is a 64-byte header followed by the raw elements. States and
+     * actions are thus written as they are in memory, and they must
+     * be trivially copyable.
+     *
+     * rl::dataset::Writer appends transitions to the files.
+     * rl::dataset::Mapping maps them in memory and provides random
+     * access iterators, that can be given to rl::lstd,
+     * rl::parallel_lstd and rl::batch_policy_iteration_step in place
+     * of the iterators of a std::vector of transitions. Only the
+     * pages that are accessed are loaded, and the system can evict
+     * them, so that datasets may be larger than the memory.
+     */
+    namespace dataset {
+
+        /**
+         * The format version, written in the header of each column.
+         */
+        constexpr std::uint32_t version = 1;
+
+        constexpr std::uint32_t byte_order = 0x01020304;
+
+        struct ColumnHeader {
+            char          magic[8];     // "RLCOLMN\0"
+            std::uint32_t version;
+            std::uint32_t byte_order;   // 0x01020304 as written by the host.
+            std::uint64_t element_size;
+            std::uint64_t size;         // The number of elements.
+            std::uint64_t reserved[4];
+        };
+
+        static_assert(sizeof(ColumnHeader) == 64, "rl::dataset::ColumnHeader must be 64 bytes long");
+
+        inline const char* magic(void) {
+            return "RLCOLMN";
+        }
+
+        /**
+         * @short Appends elements to a column file.
+         */
+        class ColumnWriter {
+
+            private:
+
+                std::string   path;
+                std::ofstream file;
+                std::size_t   element_size;
+                std::uint64_t size;
+
+                void write_header(void) {
+                    ColumnHeader header;
+                    std::memset(&header, 0, sizeof(ColumnHeader));
+                    std::memcpy(header.magic, magic(), sizeof(header.magic));
+                    header.version      = version;
+                    header.byte_order   = byte_order;
+                    header.element_size = element_size;
+                    header.size         = size;
+                    file.write((const char*)(&header), sizeof(ColumnHeader));
+                }
+
+            public:
+
+                ColumnWriter(const std::string& file_path, std::size_t elt_size)
+                    : path(file_path),
+                      file(file_path.c_str(), std::ios::binary | std::ios::trunc),
+                      element_size(elt_size), size(0) {
+                    if(!file)
+                        throw rl::exception::BadDataset(std::string("cannot open ") + path + " for writing");
+                    // The size is written again when the column is closed.
+                    write_header();
+                }
+
+                ColumnWriter(const ColumnWriter& cp) = delete;
+                ColumnWriter& operator=(const ColumnWriter& cp) = delete;
+
+                void append(const void* element) {
+                    file.write((const char*)element, element_size);
+                    ++size;
+                }
+
+                void close(void) {
+                    if(!file.is_open())
+                        return;
+                    file.seekp(0);
+                    write_header();
+                    file.close();
+                    if(!file)
+                        throw rl::exception::BadDataset(std::string("cannot write ") + path);
+                }
+        };
+
+        /**
+         * How a mapped column can be modified.
+         * - read_only: the elements cannot be modified.
+         * - copy_on_write: the elements can be modified in memory,
+         *   the file being left unchanged (as rl::snapshot::Mapping).
+         * - write_back: the modifications are written back to the
+         *   file, and seen by the other processes mapping it.
+         */
+        enum class Access {read_only, copy_on_write, write_back};
+
+        /**
+         * @short A column file mapped in memory.
+         */
+        class MappedColumn {
+
+            private:
+
+                char*       base;
+                std::size_t length;
+                std::size_t size;
+
+            public:
+
+                MappedColumn(const std::string& path, std::size_t element_size, Access access)
+                    : base(nullptr), length(0), size(0) {
+                    int fd = ::open(path.c_str(), access == Access::write_back ? O_RDWR : O_RDONLY);
+                    if(fd < 0)
+                        throw rl::exception::BadDataset(std::string("cannot open ") + path);
+                    struct stat st;
+                    if(::fstat(fd, &st) != 0 || (std::size_t)(st.st_size) < sizeof(ColumnHeader)) {
+                        ::close(fd);
+                        throw rl::exception::BadDataset(path + " is not a dataset column");
+                    }
+                    length = st.st_size;
+                    void* addr = ::mmap(nullptr, length,
+                                        access == Access::read_only ? PROT_READ : (PROT_READ | PROT_WRITE),
+                                        access == Access::copy_on_write ? MAP_PRIVATE : MAP_SHARED,
+                                        fd, 0);
+                    ::close(fd);
+                    if(addr == MAP_FAILED)
+                        throw rl::exception::BadDataset(std::string("cannot map ") + path);
+                    base = (char*)addr;
+
+                    const ColumnHeader* header = (const ColumnHeader*)base;
+                    std::string error;
+                    if(std::memcmp(header->magic, magic(), sizeof(header->magic)) != 0)
+                        error = path + " is not a dataset column";
+                    else if(header->byte_order != byte_order)
+                        error = path + " has been written with another byte order";
+                    else if(header->version != version)
+                        error = path + " : version " + std::to_string(header->version)
+                            + " found while version " + std::to_string(version) + " is expected";
+                    else if(header->element_size != element_size)
+                        error = path + " : elements of " + std::to_string(header->element_size)
+                            + " bytes found while " + std::to_string(element_size) + " bytes are expected";
+                    else if(header->size > (length - sizeof(ColumnHeader))/element_size)
+                        error = path + " is truncated";
+                    if(error != "") {
+                        ::munmap(base, length);
+                        throw rl::exception::BadDataset(error);
+                    }
+                    size = header->size;
+                    // Batch algorithms scan the transitions in order.
+                    ::madvise(base, length, MADV_SEQUENTIAL);
+                }
+
+                MappedColumn(const MappedColumn& cp) = delete;
+                MappedColumn& operator=(const MappedColumn& cp) = delete;
+
+                ~MappedColumn() {
+                    ::munmap(base, length);
+                }
+
+                std::size_t elements(void) const {
+                    return size;
+                }
+
+                void* data(void) const {
+                    return base + sizeof(ColumnHeader);
+                }
+        };
+
+        /**
+         * @short Writes a transition dataset.
+         *
+         * The files are complete once close() has been called (the
+         * destructor does it).
+         */
+        template<typename STATE, typename ACTION>
+            class Writer {
+
+                static_assert(std::is_trivially_copyable<STATE>::value,  "rl::dataset requires trivially copyable states");
+                static_assert(std::is_trivially_copyable<ACTION>::value, "rl::dataset requires trivially copyable actions");
+
+                private:
+
+                    ColumnWriter  s_column;
+                    ColumnWriter  a_column;
+                    ColumnWriter  r_column;
+                    ColumnWriter  s__column;
+                    ColumnWriter  a__column;
+                    ColumnWriter  terminal_column;
+                    std::size_t   nb_transitions;
+
+                    void push(const STATE& s, const ACTION& a, double r,
+                              const STATE& s_, const ACTION& a_, std::uint8_t terminal) {
+                        s_column.append(&s);
+                        a_column.append(&a);
+                        r_column.append(&r);
+                        s__column.append(&s_);
+                        a__column.append(&a_);
+                        terminal_column.append(&terminal);
+                        ++nb_transitions;
+                    }
+
+                public:
+
+                    Writer(const std::string& path)
+                        : s_column(path + ".s", sizeof(STATE)),
+                          a_column(path + ".a", sizeof(ACTION)),
+                          r_column(path + ".r", sizeof(double)),
+                          s__column(path + ".s_", sizeof(STATE)),
+                          a__column(path + ".a_", sizeof(ACTION)),
+                          terminal_column(path + ".terminal", sizeof(std::uint8_t)),
+                          nb_transitions(0) {}
+
+                    Writer(const Writer& cp) = delete;
+                    Writer& operator=(const Writer& cp) = delete;
+
+                    ~Writer() {
+                        try {
+                            close();
+                        }
+                        catch(...) {}
+                    }
+
+                    /**
+                     * This appends the transition (s, a, r, s', a').
+                     */
+                    void push(const STATE& s, const ACTION& a, double r,
+                              const STATE& s_, const ACTION& a_) {
+                        push(s, a, r, s_, a_, 0);
+                    }
+
+                    /**
+                     * This appends a terminal transition (s, a, r). s' and a' are unused.
+                     */
+                    void push(const STATE& s, const ACTION& a, double r) {
+                        push(s, a, r, s, a, 1);
+                    }
+
+                    std::size_t size(void) const {
+                        return nb_transitions;
+                    }
+
+                    void close(void) {
+                        s_column.close();
+                        a_column.close();
+                        r_column.close();
+                        s__column.close();
+                        a__column.close();
+                        terminal_column.close();
+                    }
+            };
+
+        /**
+         * @short A transition dataset mapped in memory.
+         *
+         * The next actions are the only data that can be modified
+         * (see Transition::set_next_action). By default, they are
+         * modified in a private copy of the pages, and the path.a_
+         * file keeps the logged actions. Use Access::write_back to
+         * store the modifications in the file, or Access::read_only
+         * to forbid them.
+         */
+        template<typename STATE, typename ACTION>
+            class Mapping {
+
+                static_assert(std::is_trivially_copyable<STATE>::value,  "rl::dataset requires trivially copyable states");
+                static_assert(std::is_trivially_copyable<ACTION>::value, "rl::dataset requires trivially copyable actions");
+
+                private:
+
+                    MappedColumn  s_column;
+                    MappedColumn  a_column;
+                    MappedColumn  r_column;
+                    MappedColumn  s__column;
+                    MappedColumn  a__column;
+                    MappedColumn  terminal_column;
+
+                    const STATE*        s_data;
+                    const ACTION*       a_data;
+                    const double*       r_data;
+                    const STATE*        s__data;
+                    const ACTION*       a__data;
+                    ACTION*             writable_a__data; // nullptr if read-only.
+                    const std::uint8_t* terminal_data;
+                    std::size_t         nb_transitions;
+
+                public:
+
+                    /**
+                     * @short The transition at some index of the dataset.
+                     *
+                     * This is a light handle on the columns, the
+                     * data are read when the accessors are called.
+                     */
+                    class Transition {
+
+                        private:
+
+                            const Mapping* dataset;
+                            std::size_t    index;
+
+                            friend class Mapping;
+
+                            Transition(const Mapping* d, std::size_t i) : dataset(d), index(i) {}
+
+                        public:
+
+                            Transition(void) : dataset(nullptr), index(0) {}
+
+                            const STATE&  s(void)           const {return dataset->s_data[index];}
+                            const ACTION& a(void)           const {return dataset->a_data[index];}
+                            double        r(void)           const {return dataset->r_data[index];}
+                            const STATE&  s_(void)          const {return dataset->s__data[index];}
+                            const ACTION& a_(void)          const {return dataset->a__data[index];}
+                            bool          is_terminal(void) const {return dataset->terminal_data[index] != 0;}
+                            std::size_t   position(void)    const {return index;}
+
+                            void set_next_action(const ACTION& a) const {
+                                if(dataset->writable_a__data == nullptr)
+                                    throw rl::exception::BadDataset("the next actions of the dataset are read-only");
+                                dataset->writable_a__data[index] = a;
+                            }
+                    };
+
+                    /**
+                     * @short Random access iterator on the transitions.
+                     *
+                     * *it returns a Transition handle by value, and
+                     * it->... calls the accessors of such a copy.
+                     */
+                    class iterator {
+
+                        private:
+
+                            Transition t;
+
+                            friend class Mapping;
+
+                            iterator(const Mapping* d, std::size_t i) : t(d, i) {}
+
+                        public:
+
+                            // The result of operator->, holding its own copy of the handle.
+                            class arrow {
+                                private:
+                                    Transition t;
+                                public:
+                                    arrow(const Transition& handle) : t(handle) {}
+                                    const Transition* operator->(void) const {return &t;}
+                            };
+
+                            using iterator_category = std::random_access_iterator_tag;
+                            using value_type        = Transition;
+                            using difference_type   = std::ptrdiff_t;
+                            using pointer           = arrow;
+                            using reference         = const Transition;
+
+                            iterator(void) : t() {}
+
+                            reference  operator*(void)  const {return t;}
+                            pointer    operator->(void) const {return arrow(t);}
+                            reference  operator[](difference_type n) const {return Transition(t.dataset, t.index + n);}
+
+                            iterator& operator++(void)                 {++t.index; return *this;}
+                            iterator& operator--(void)                 {--t.index; return *this;}
+                            iterator  operator++(int)                  {iterator res = *this; ++t.index; return res;}
+                            iterator  operator--(int)                  {iterator res = *this; --t.index; return res;}
+                            iterator& operator+=(difference_type n)    {t.index += n; return *this;}
+                            iterator& operator-=(difference_type n)    {t.index -= n; return *this;}
+                            iterator  operator+(difference_type n) const {return iterator(t.dataset, t.index + n);}
+                            iterator  operator-(difference_type n) const {return iterator(t.dataset, t.index - n);}
+                            friend iterator operator+(difference_type n, const iterator& it) {return it + n;}
+
+                            difference_type operator-(const iterator& other) const {return (difference_type)(t.index) - (difference_type)(other.t.index);}
+
+                            bool operator==(const iterator& other) const {return t.index == other.t.index;}
+                            bool operator!=(const iterator& other) const {return t.index != other.t.index;}
+                            bool operator< (const iterator& other) const {return t.index <  other.t.index;}
+                            bool operator> (const iterator& other) const {return t.index >  other.t.index;}
+                            bool operator<=(const iterator& other) const {return t.index <= other.t.index;}
+                            bool operator>=(const iterator& other) const {return t.index >= other.t.index;}
+                    };
+
+                    using transition_type = Transition;
+
+                    Mapping(const std::string& path, Access next_actions = Access::copy_on_write)
+                        : s_column(path + ".s", sizeof(STATE), Access::read_only),
+                          a_column(path + ".a", sizeof(ACTION), Access::read_only),
+                          r_column(path + ".r", sizeof(double), Access::read_only),
+                          s__column(path + ".s_", sizeof(STATE), Access::read_only),
+                          a__column(path + ".a_", sizeof(ACTION), next_actions),
+                          terminal_column(path + ".terminal", sizeof(std::uint8_t), Access::read_only),
+                          s_data((const STATE*)(s_column.data())),
+                          a_data((const ACTION*)(a_column.data())),
+                          r_data((const double*)(r_column.data())),
+                          s__data((const STATE*)(s__column.data())),
+                          a__data((const ACTION*)(a__column.data())),
+                          writable_a__data(next_actions != Access::read_only ? (ACTION*)(a__column.data()) : nullptr),
+                          terminal_data((const std::uint8_t*)(terminal_column.data())),
+                          nb_transitions(s_column.elements()) {
+                        if(a_column.elements()        != nb_transitions
+                           || r_column.elements()        != nb_transitions
+                           || s__column.elements()       != nb_transitions
+                           || a__column.elements()       != nb_transitions
+                           || terminal_column.elements() != nb_transitions)
+                            throw rl::exception::BadDataset(path + " : the columns have different sizes");
+                    }
+
+                    Mapping(const Mapping& cp) = delete;
+                    Mapping& operator=(const Mapping& cp) = delete;
+
+                    std::size_t size(void) const {
+                        return nb_transitions;
+                    }
+
+                    iterator begin(void) const {
+                        return iterator(this, 0);
+                    }
+
+                    iterator end(void) const {
+                        return iterator(this, nb_transitions);
+                    }
+
+                    Transition operator[](std::size_t index) const {
+                        return Transition(this, index);
+                    }
+            };
+    }
+}
@@ -27,12 +27,49 @@
 #pragma once
 
 #include <utility>
+#include <new>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <type_traits>
 
 #include <rlException.hpp>
 #include <rlTraits.hpp>
+#include <rlThreadPool.hpp>
 
 namespace rl {
     namespace episode {
+
+        /**
+         * This triggers simulator.timeStep(action) and tells whether a
+         * terminal state has been reached. If the simulator provides
+         * the exception-free bool timeStep(action,std::nothrow), it is
+         * used, so that no exception is raised at the end of the
+         * episode. Otherwise, rl::exception::Terminal is caught.
+         * @return true if the transition is a terminal one.
+         */
+        template<typename SIMULATOR,
+            typename ACTION>
+                typename std::enable_if_t<rl::traits::has_nothrow_time_step<SIMULATOR, ACTION>::value, bool>
+                time_step(SIMULATOR& simulator,
+                        const ACTION& action) {
+                    return simulator.timeStep(action,std::nothrow);
+                }
+
+        template<typename SIMULATOR,
+            typename ACTION>
+                typename std::enable_if_t<!rl::traits::has_nothrow_time_step<SIMULATOR, ACTION>::value, bool>
+                time_step(SIMULATOR& simulator,
+                        const ACTION& action) {
+                    try {
+                        simulator.timeStep(action);
+                    }
+                    catch(rl::exception::Terminal& e) {
+                        return true;
+                    }
+                    return false;
+                }
+
         /**
          * This triggers an interaction from an action and returns a transition.
          * @param make_transition T = make_transition(s,a,r,ss);
@@ -50,12 +87,9 @@ namespace rl {
                             action,
                             simulator.reward())) {
                     auto current = simulator.sense();
-                    try {
-                        simulator.timeStep(action);
-                        return make_transition(current,action,simulator.reward(),simulator.sense());
-                    }
-                    catch(rl::exception::Terminal& e) {}
-                    return make_terminal_transition(current,action,simulator.reward());
+                    if(rl::episode::time_step(simulator,action))
+                        return make_terminal_transition(current,action,simulator.reward());
+                    return make_transition(current,action,simulator.reward(),simulator.sense());
                 }
 
         /**
@@ -76,12 +110,82 @@ namespace rl {
                             simulator.reward())) {
                     auto current = simulator.sense();
                     auto      a  = policy(current);
-                    try {
-                        simulator.timeStep(a);
-                        return make_transition(current,a,simulator.reward(),simulator.sense());
+                    if(rl::episode::time_step(simulator,a))
+                        return make_terminal_transition(current,a,simulator.reward());
+                    return make_transition(current,a,simulator.reward(),simulator.sense());
+                }
+
+        /**
+         * This feeds the critic with a transition, according to the
+         * kind of critic (SRS, SARS or SARSA).
+         */
+        template<typename SRS_CRITIC,
+            typename STATE, typename ACTION>
+                typename std::enable_if_t<rl::traits::is_srs_critic<SRS_CRITIC, STATE>::value, void>
+                learn_transition(SRS_CRITIC& critic,
+                        const STATE& s, const ACTION& a, double r,
+                        const STATE& s_, const ACTION& a_) {
+                    critic.learn(s,r,s_);
+                }
+
+        template<typename SARS_CRITIC,
+            typename STATE, typename ACTION>
+                typename std::enable_if_t<rl::traits::is_sars_critic<SARS_CRITIC, STATE, ACTION>::value, void>
+                learn_transition(SARS_CRITIC& critic,
+                        const STATE& s, const ACTION& a, double r,
+                        const STATE& s_, const ACTION& a_) {
+                    critic.learn(s,a,r,s_);
+                }
+
+        template<typename SARSA_CRITIC,
+            typename STATE, typename ACTION>
+                typename std::enable_if_t<rl::traits::is_sarsa_critic<SARSA_CRITIC, STATE, ACTION>::value, void>
+                learn_transition(SARSA_CRITIC& critic,
+                        const STATE& s, const ACTION& a, double r,
+                        const STATE& s_, const ACTION& a_) {
+                    critic.learn(s,a,r,s_,a_);
+                }
+
+        /**
+         * This feeds the critic with a terminal transition.
+         */
+        template<typename SRS_CRITIC,
+            typename STATE, typename ACTION>
+                typename std::enable_if_t<rl::traits::is_srs_critic<SRS_CRITIC, STATE>::value, void>
+                learn_terminal_transition(SRS_CRITIC& critic,
+                        const STATE& s, const ACTION& a, double r) {
+                    critic.learn(s,r);
+                }
+
+        template<typename CRITIC,
+            typename STATE, typename ACTION>
+                typename std::enable_if_t<!rl::traits::is_srs_critic<CRITIC, STATE>::value, void>
+                learn_terminal_transition(CRITIC& critic,
+                        const STATE& s, const ACTION& a, double r) {
+                    critic.learn(s,a,r);
+                }
+
+        /**
+         * This is the exception-free version of adaptation. 
+         * @param sa The current (s,a) pair, that is replaced by the next one (s',a') if the transition is not terminal.
+         * @return true if a terminal transition is reached.
+         */
+        template<typename SIMULATOR,typename POLICY,
+            typename STATE, typename ACTION,
+            typename CRITIC>
+                bool adaptation_step(SIMULATOR& simulator,
+                        const POLICY& policy,
+                        CRITIC& critic,
+                        std::pair<STATE,ACTION>& sa) {
+                    if(rl::episode::time_step(simulator,sa.second)) {
+                        rl::episode::learn_terminal_transition(critic,sa.first,sa.second,simulator.reward());
+                        return true;
                     }
-                    catch(rl::exception::Terminal& e) {}
-                    return make_terminal_transition(current,a,simulator.reward());
+                    auto next = simulator.sense();
+                    auto next_sa = std::make_pair(next,policy(next));
+                    rl::episode::learn_transition(critic,sa.first,sa.second,simulator.reward(),next_sa.first,next_sa.second);
+                    sa = next_sa;
+                    return false;
                 }
 
         /**
@@ -103,17 +207,10 @@ namespace rl {
                         SRS_CRITIC& critic,
                         const STATE& s,
                         const ACTION& a) {
-                    try {
-                        simulator.timeStep(a);
-                        auto next = simulator.sense();
-                        auto res = std::make_pair(next,policy(next));
-                        critic.learn(s,simulator.reward(),next);
-                        return res;
-                    }
-                    catch(rl::exception::Terminal& e) { 
-                        critic.learn(s,simulator.reward());
-                        throw e;
-                    }
+                    auto sa = std::make_pair(s,a);
+                    if(rl::episode::adaptation_step(simulator,policy,critic,sa))
+                        throw rl::exception::Terminal("in rl::episode::adaptation");
+                    return sa;
                 }
 
         /**
@@ -135,17 +232,10 @@ namespace rl {
                         SARS_CRITIC& critic,
                         const STATE& s,
                         const ACTION& a) {
-                    try {
-                        simulator.timeStep(a);
-                        auto next = simulator.sense();
-                        auto res = std::make_pair(next,policy(next));
-                        critic.learn(s,a,simulator.reward(),next);
-                        return res;
-                    }
-                    catch(rl::exception::Terminal& e) { 
-                        critic.learn(s,a,simulator.reward());
-                        throw e;
-                    }
+                    auto sa = std::make_pair(s,a);
+                    if(rl::episode::adaptation_step(simulator,policy,critic,sa))
+                        throw rl::exception::Terminal("in rl::episode::adaptation");
+                    return sa;
                 }
 
         /**
@@ -167,17 +257,10 @@ namespace rl {
                         SARSA_CRITIC& critic,
                         const STATE& s,
                         const ACTION& a) {
-                    try {
-                        simulator.timeStep(a);
-                        auto next = simulator.sense();
-                        auto res = std::make_pair(next,policy(next));
-                        critic.learn(s,a,simulator.reward(),next,res.second);
-                        return res;
-                    }
-                    catch(rl::exception::Terminal& e) { 
-                        critic.learn(s,a,simulator.reward());
-                        throw e;
-                    }
+                    auto sa = std::make_pair(s,a);
+                    if(rl::episode::adaptation_step(simulator,policy,critic,sa))
+                        throw rl::exception::Terminal("in rl::episode::adaptation");
+                    return sa;
                 }
 
 
@@ -217,13 +300,11 @@ namespace rl {
                     const POLICY& policy,
                     unsigned int max_episode_duration) {
                 unsigned int length=0;
-                try {
-                    do {
-                        ++length;
-                        simulator.timeStep(policy(simulator.sense()));
-                    } while(length != max_episode_duration);
-                }
-                catch(rl::exception::Terminal& e) {}
+                do {
+                    ++length;
+                    if(rl::episode::time_step(simulator,policy(simulator.sense())))
+                        break;
+                } while(length != max_episode_duration);
                 return length;
             }
 
@@ -248,19 +329,17 @@ namespace rl {
                     unsigned int length=0;
                     auto s = simulator.sense();
                     auto a = policy(s);
-                    try {
-                        do {
-                            ++length;
-                            simulator.timeStep(a);
-                            auto s_ = simulator.sense();
-                            *(out++) = make_transition(s,a,simulator.reward(),s_);
-                            s = s_;
-                            a = policy(s);
-                        } while(length != max_episode_duration);
-                    }
-                    catch(rl::exception::Terminal& e) { 
-                        *(out++) = make_terminal_transition(s,a,simulator.reward());
-                    }
+                    do {
+                        ++length;
+                        if(rl::episode::time_step(simulator,a)) {
+                            *(out++) = make_terminal_transition(s,a,simulator.reward());
+                            break;
+                        }
+                        auto s_ = simulator.sense();
+                        *(out++) = make_transition(s,a,simulator.reward(),s_);
+                        s = s_;
+                        a = policy(s);
+                    } while(length != max_episode_duration);
                     return length;
                 }
 
@@ -278,13 +357,11 @@ namespace rl {
                     unsigned int length=0;
                     auto s  = simulator.sense();
                     auto sa = std::make_pair(s,policy(s));
-                    try {
-                        do {
-                            ++length;
-                            sa = rl::episode::adaptation(simulator,policy,critic,sa.first,sa.second);
-                        } while(length != max_episode_duration);
-                    }
-                    catch(rl::exception::Terminal& e) {}
+                    do {
+                        ++length;
+                        if(rl::episode::adaptation_step(simulator,policy,critic,sa))
+                            break;
+                    } while(length != max_episode_duration);
                     return length;
                 }
 
@@ -312,19 +389,164 @@ namespace rl {
                     unsigned int length=0;
                     auto s = simulator.sense();
                     auto sa = std::make_pair(s,policy(s));
-                    try {
-                        do {
-                            ++length;
-                            auto sa_ = rl::episode::adaptation(simulator,policy,critic,sa.first,sa.second);
-                            auto s_ = simulator.sense();
-                            *(out++) = make_transition(sa.first,sa.second,simulator.reward(),sa_.first,sa_.second);
-                            sa = sa_;
-                        } while(length != max_episode_duration);
-                    }
-                    catch(rl::exception::Terminal& e) { 
-                        *(out++) = make_terminal_transition(sa.first,sa.second,simulator.reward());
-                    }
+                    do {
+                        ++length;
+                        auto sa_ = sa;
+                        if(rl::episode::adaptation_step(simulator,policy,critic,sa_)) {
+                            *(out++) = make_terminal_transition(sa.first,sa.second,simulator.reward());
+                            break;
+                        }
+                        *(out++) = make_transition(sa.first,sa.second,simulator.reward(),sa_.first,sa_.second);
+                        sa = sa_;
+                    } while(length != max_episode_duration);
                     return length;
                 }
+
+        /**
+         * This collects the transitions of nb_episodes episodes, run
+         * on nb_threads threads. Each thread owns its random
+         * generator and its policy, and stores its transitions in its
+         * own buffer, so that no locking is needed. At the beginning
+         * of each episode, the random generator of the thread is
+         * reseeded from (master_seed, episode) and a fresh simulator
+         * is built from it, since simulators may own an internal
+         * generator seeded at construction. The buffers are merged in
+         * the episode order. The output is thus the same for a given
+         * master seed, whatever the number of threads. The threads
+         * are those of a rl::ThreadPool.
+         * @param nb_threads the number of threads, 0 means std::thread::hardware_concurrency().
+         * @param make_simulator sim = make_simulator(gen), gen is the generator of the thread.
+         * @param make_policy policy = make_policy(gen).
+         * @param start_episode start_episode(sim,gen) initializes the simulator before each episode.
+         * @param out an output iterator
+         * @param make_transition *(out++) = make_transition(s,a,r,ss);
+         * @param make_terminal_transition *(out++) = make_terminal_transition(s,a,r);
+         * @param max_episode_duration put a null number to run the episodes without length limitation.
+         * @return the total number of transitions.
+         */
+        template<typename RANDOM_GENERATOR,
+            typename fctMAKE_SIMULATOR,
+            typename fctMAKE_POLICY,
+            typename fctSTART_EPISODE,
+            typename OUTPUT_ITER,
+            typename fctMAKE_TRANSITION,
+            typename fctMAKE_TERMINAL_TRANSITION>
+                unsigned int parallel_run(unsigned int nb_episodes,
+                        unsigned int nb_threads,
+                        std::uint_least32_t master_seed,
+                        const fctMAKE_SIMULATOR& make_simulator,
+                        const fctMAKE_POLICY& make_policy,
+                        const fctSTART_EPISODE& start_episode,
+                        OUTPUT_ITER out,
+                        const fctMAKE_TRANSITION& make_transition,
+                        const fctMAKE_TERMINAL_TRANSITION& make_terminal_transition,
+                        unsigned int max_episode_duration) {
+                    using simulator_type  = std::decay_t<decltype(make_simulator(std::declval<RANDOM_GENERATOR&>()))>;
+                    using policy_type     = std::decay_t<decltype(make_policy(std::declval<RANDOM_GENERATOR&>()))>;
+                    using transition_type = std::decay_t<decltype(make_terminal_transition(std::declval<simulator_type&>().sense(),
+                                std::declval<const policy_type&>()(std::declval<simulator_type&>().sense()),
+                                std::declval<simulator_type&>().reward()))>;
+
+                    if(nb_episodes == 0)
+                        return 0;
+                    if(nb_threads > nb_episodes)
+                        nb_threads = nb_episodes;
+                    rl::ThreadPool pool(nb_threads);
+                    unsigned int nb_chunks = pool.size();
+
+                    std::vector<std::vector<transition_type>> buffers(nb_chunks);
+
+                    pool.run([&](unsigned int thread_id) {
+                            RANDOM_GENERATOR gen;
+                            auto  policy = make_policy(gen);
+                            auto& buffer = buffers[thread_id];
+                            auto  output = std::back_inserter(buffer);
+                            unsigned int first = (unsigned int)(((unsigned long long)nb_episodes * thread_id)     / nb_chunks);
+                            unsigned int last  = (unsigned int)(((unsigned long long)nb_episodes * (thread_id+1)) / nb_chunks);
+                            for(unsigned int episode = first; episode < last; ++episode) {
+                                std::seed_seq seq({master_seed, (std::uint_least32_t)episode});
+                                gen.seed(seq);
+                                auto simulator = make_simulator(gen);
+                                start_episode(simulator,gen);
+                                rl::episode::run(simulator,policy,output,
+                                        make_transition,make_terminal_transition,
+                                        max_episode_duration);
+                            }
+                        });
+
+                    unsigned int size = 0;
+                    for(auto& buffer : buffers) {
+                        size += buffer.size();
+                        for(auto& t : buffer)
+                            *(out++) = std::move(t);
+                    }
+                    return size;
+                }
+
+        /**
+         * This runs nb_episodes learning episodes on nb_threads
+         * threads, all the critics sharing the same parameter vector
+         * (Hogwild-like learning). Each thread owns its random
+         * generator, its policy and its critic, built from the
+         * factories. If the critic provides a concurrent attribute
+         * (rl::gsl::TD, rl::gsl::QLearning), it is set, so that the
+         * updates of the shared parameter are lock-free atomic
+         * additions. The result is not deterministic, since the
+         * threads interleave their updates. The threads are those of
+         * a rl::ThreadPool.
+         * @param nb_threads the number of threads, 0 means std::thread::hardware_concurrency().
+         * @param make_simulator sim = make_simulator(gen), gen is the generator of the thread.
+         * @param make_policy policy = make_policy(gen).
+         * @param make_critic critic = make_critic(), the critic must work on the shared parameter.
+         * @param start_episode start_episode(sim,gen) initializes the simulator before each episode.
+         * @param max_episode_duration put a null number to run the episodes without length limitation.
+         * @return the total number of transitions.
+         */
+        template<typename RANDOM_GENERATOR,
+            typename fctMAKE_SIMULATOR,
+            typename fctMAKE_POLICY,
+            typename fctMAKE_CRITIC,
+            typename fctSTART_EPISODE>
+                unsigned int parallel_learn(unsigned int nb_episodes,
+                        unsigned int nb_threads,
+                        std::uint_least32_t master_seed,
+                        const fctMAKE_SIMULATOR& make_simulator,
+                        const fctMAKE_POLICY& make_policy,
+                        const fctMAKE_CRITIC& make_critic,
+                        const fctSTART_EPISODE& start_episode,
+                        unsigned int max_episode_duration) {
+                    if(nb_episodes == 0)
+                        return 0;
+                    if(nb_threads > nb_episodes)
+                        nb_threads = nb_episodes;
+                    rl::ThreadPool pool(nb_threads);
+                    unsigned int nb_chunks = pool.size();
+
+                    std::vector<unsigned int> lengths(nb_chunks,0);
+
+                    pool.run([&](unsigned int thread_id) {
+                            RANDOM_GENERATOR gen;
+                            auto policy = make_policy(gen);
+                            auto critic = make_critic();
+                            if constexpr (rl::traits::has_concurrent_mode<decltype(critic)>::value)
+                                critic.concurrent = true;
+                            unsigned int first = (unsigned int)(((unsigned long long)nb_episodes * thread_id)     / nb_chunks);
+                            unsigned int last  = (unsigned int)(((unsigned long long)nb_episodes * (thread_id+1)) / nb_chunks);
+                            unsigned int length = 0;
+                            for(unsigned int episode = first; episode < last; ++episode) {
+                                std::seed_seq seq({master_seed, (std::uint_least32_t)episode});
+                                gen.seed(seq);
+                                auto simulator = make_simulator(gen);
+                                start_episode(simulator,gen);
+                                length += rl::episode::learn(simulator,policy,critic,max_episode_duration);
+                            }
+                            lengths[thread_id] = length;
+                        });
+
+                    unsigned int size = 0;
+                    for(auto l : lengths)
+                        size += l;
+                    return size;
+                }
     }		  
 }
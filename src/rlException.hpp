@@ -99,5 +99,39 @@ namespace rl {
 	: Any(std::string("Got a gsl_vector*=NULL : ")+comment) {}
     };
 
+    /**
+     * @short Unreadable or inconsistent snapshot file.
+     *
+     * See rl::snapshot::Mapping.
+     */
+    class BadSnapshot : public Any {
+    public:
+      
+      BadSnapshot(std::string comment) 
+	: Any(std::string("Bad snapshot : ")+comment) {}
+    };
+
+    /**
+     * @short Unreadable or inconsistent transition dataset.
+     *
+     * See rl::dataset::Mapping.
+     */
+    class BadDataset : public Any {
+    public:
+      
+      BadDataset(std::string comment) 
+	: Any(std::string("Bad dataset : ")+comment) {}
+    };
+
+    /**
+     * @short An iterative solver did not reach the required precision.
+     */
+    class NotConverged : public Any {
+    public:
+      
+      NotConverged(std::string comment) 
+	: Any(std::string("No convergence : ")+comment) {}
+    };
+
   }
 }
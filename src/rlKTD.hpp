@@ -31,11 +31,15 @@
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_linalg.h>
 #include <cmath>
+#include <cstddef>
 #include <functional>
+#include <memory>
 
 #include <rlException.hpp>
+#include <rlThreadPool.hpp>
 #include <rlAlgo.hpp>
 #include <rlTypes.hpp>
+#include <rlSnapshot.hpp>
 
 namespace rl {
 
@@ -60,6 +64,7 @@ namespace rl {
                         double ut_beta;               // default    2
                         double ut_kappa;              // default    0
                         bool   use_linear_evaluation; // default false, use true for linear methods, i.e q(theta,s,a) = theta.phi(s,a).
+                        bool   use_square_root_update; // default false, use true for the O(n^2) square-root update of the covariance factor (see kalmanUpdate).
 
 
                     protected:
@@ -85,6 +90,7 @@ namespace rl {
 
 
                         std::function<double (const gsl_vector*, const STATE&, const ACTION&)> q;
+                        std::shared_ptr<rl::ThreadPool> pool;
 
                         void read(std::istream& is) {
                             is >> w_m0 
@@ -250,6 +256,110 @@ namespace rl {
                         }
 
 
+                        /*
+                           This is the square-root counterpart of
+                           centralDifferencesTransform. Row j of the
+                           sigma point matrix only depends on theta_j
+                           and on row j of the (lower triangular)
+                           factor, so both are read and written
+                           contiguously.
+                           */
+                        void squareRootSigmaPoints(void) {
+                            unsigned int i,j;
+                            double c = sqrt(theta_size+lambdaUt);
+                            const double* L   = sigmaTheta->data;
+                            std::size_t   ldl = sigmaTheta->tda;
+                            double*       SP  = sigmaPointsSet->data;
+                            std::size_t   lds = sigmaPointsSet->tda;
+
+                            for(j=0; j<theta_size; ++j) {
+                                const double* Lj  = L  + j*ldl;
+                                double*       SPj = SP + j*lds;
+                                double        t   = gsl_vector_get(theta,j);
+                                SPj[0] = t;
+                                for(i=0; i<=j; ++i) {
+                                    double d = c*Lj[i];
+                                    SPj[1+i]            = t + d;
+                                    SPj[1+theta_size+i] = t - d;
+                                }
+                                for(; i<theta_size; ++i) {
+                                    SPj[1+i]            = t;
+                                    SPj[1+theta_size+i] = t;
+                                }
+                            }
+                        }
+
+                        /*
+                           This computes the parameter/reward
+                           correlation from the factor. The centered
+                           sigma points are +/- c.L_i, L_i being the
+                           i-th column of the factor, so that
+                           P_theta_r = c.L.v, with v_i = w_i.(images_{1+i} - images_{1+n+i}).
+                           */
+                        void squareRootCorrelation(void) {
+                            unsigned int i,j;
+                            double c = sqrt(theta_size+lambdaUt);
+                            const double* L   = sigmaTheta->data;
+                            std::size_t   ldl = sigmaTheta->tda;
+                            double*       v   = centeredSP->data;
+                            std::size_t   inc = centeredSP->stride;
+
+                            for(i=0; i<theta_size; ++i)
+                                v[i*inc] = w_i * (gsl_vector_get(ktdQ_images_SP,1+i) - gsl_vector_get(ktdQ_images_SP,1+theta_size+i));
+
+                            for(j=0; j<theta_size; ++j) {
+                                const double* Lj = L + j*ldl;
+                                double sum = 0;
+                                for(i=0; i<=j; ++i)
+                                    sum += Lj[i]*v[i*inc];
+                                gsl_vector_set(P_theta_r,j,c*sum);
+                            }
+                        }
+
+                        /*
+                           This replaces the lower triangular factor L
+                           (sigmaTheta) by the Cholesky factor of
+                           L.L^T - alpha.x.x^T, alpha > 0, with the
+                           classical rotation-based rank-one downdate
+                           (see e.g. Golub and Van Loan, Matrix
+                           Computations, sec. 6.5.4). x is modified.
+
+                           The rotations are usually applied column
+                           by column. Here, they are applied row by
+                           row, which is equivalent since row i only
+                           depends on the rotations (c_k,s_k), k<i,
+                           and on x_i. Each row of L is thus
+                           processed contiguously, in a single pass,
+                           in O(n^2) overall.
+                           */
+                        void choleskyDowndate(double alpha, gsl_vector *x) {
+                            unsigned int i,k;
+                            double*     L   = sigmaTheta->data;
+                            std::size_t ldl = sigmaTheta->tda;
+                            double*     cs  = D->data;  // cosines, D is used as a workspace here.
+                            double*     sn  = y->data;  // sines, y is used as a workspace here.
+                            std::size_t inc = x->stride;
+                            double      a   = sqrt(alpha);
+
+                            for(i=0; i<theta_size; ++i) {
+                                double* Li = L + i*ldl;
+                                double  xi = a*x->data[i*inc];
+                                for(k=0; k<i; ++k) {
+                                    double lik = (Li[k] - sn[k]*xi)/cs[k];
+                                    xi    = cs[k]*xi - sn[k]*lik;
+                                    Li[k] = lik;
+                                }
+                                double lii = Li[i];
+                                double r2  = lii*lii - xi*xi;
+                                if(!(r2 > 0) || lii == 0)
+                                    throw exception::NotPositiveDefiniteMatrix("in ..::KTD::choleskyDowndate");
+                                double r = sqrt(r2);
+                                cs[i]  = r/lii;
+                                sn[i]  = xi/lii;
+                                Li[i]  = r;
+                            }
+                        }
+
                         void kalmanUpdate(const STATE& state, const ACTION& action,
                                 double reward,
                                 const STATE& next_state,const ACTION& next_action,
@@ -258,7 +368,6 @@ namespace rl {
                             // initializations
                             unsigned int i;
                             double d, P_r, pred_r;
-                            double qValue;
                             gsl_vector sigmaPoint; /* Not a pointer ! */
 
                             /*
@@ -273,24 +382,24 @@ namespace rl {
                                */
 
                             // compute the sigma-points (weights are initialized at the creation of the agent)
-                            centralDifferencesTransform();
+                            if(use_square_root_update)
+                                squareRootSigmaPoints();
+                            else
+                                centralDifferencesTransform();
 
                             //compute their images
-                            if(is_terminal)
-                                for(i=0; i<theta_bound; ++i){
-                                    sigmaPoint = gsl_matrix_column(sigmaPointsSet,i).vector;
-                                    qValue = q(&sigmaPoint,
-                                            state,action);
-                                    gsl_vector_set(ktdQ_images_SP,i,(double)(qValue));
-                                }
-                            else {
-                                for(i=0; i<theta_bound; ++i){
-                                    sigmaPoint = gsl_matrix_column(sigmaPointsSet,i).vector;
-                                    qValue = q(&sigmaPoint,state,action);
-                                    gsl_vector_set(ktdQ_images_SP,i,
-                                            (double)(qValue - gamma * nextValue(next_state,next_action,i)));
-                                }
-                            }
+                            auto image = [this,&state,&action,&next_state,&next_action,is_terminal](std::size_t i, unsigned int) {
+                                gsl_vector_const_view sigmaPoint = gsl_matrix_const_column(sigmaPointsSet,i);
+                                double qValue = q(&(sigmaPoint.vector),state,action);
+                                if(!is_terminal)
+                                    qValue -= gamma * nextValue(next_state,next_action,i);
+                                gsl_vector_set(ktdQ_images_SP,i,qValue);
+                            };
+                            if(pool)
+                                pool->parallel_for(theta_bound,image);
+                            else
+                                for(i=0; i<theta_bound; ++i)
+                                    image(i,0);
 
 
                             /*
@@ -315,12 +424,16 @@ namespace rl {
                             P_r += observation_noise;
 
                             // Correlation between parameters and reward
-                            gsl_vector_set_zero(P_theta_r) ;
-                            for(i=1; i<theta_bound; ++i){
-                                sigmaPoint = gsl_matrix_column(sigmaPointsSet,i).vector;
-                                gsl_vector_memcpy(centeredSP, &sigmaPoint) ;
-                                gsl_vector_sub(centeredSP,theta) ;
-                                gsl_blas_daxpy(w_i * (gsl_vector_get(ktdQ_images_SP,i) - pred_r), centeredSP, P_theta_r) ;
+                            if(use_square_root_update)
+                                squareRootCorrelation();
+                            else {
+                                gsl_vector_set_zero(P_theta_r) ;
+                                for(i=1; i<theta_bound; ++i){
+                                    sigmaPoint = gsl_matrix_column(sigmaPointsSet,i).vector;
+                                    gsl_vector_memcpy(centeredSP, &sigmaPoint) ;
+                                    gsl_vector_sub(centeredSP,theta) ;
+                                    gsl_blas_daxpy(w_i * (gsl_vector_get(ktdQ_images_SP,i) - pred_r), centeredSP, P_theta_r) ;
+                                }
                             }
 
                             /*
@@ -335,7 +448,10 @@ namespace rl {
                             gsl_blas_daxpy(reward - pred_r, kalmanGain, theta);
 
                             // Update Covariance
-                            choleskyUpdate(-P_r,kalmanGain);
+                            if(use_square_root_update)
+                                choleskyDowndate(P_r,kalmanGain);
+                            else
+                                choleskyUpdate(-P_r,kalmanGain);
                         }
 
 
@@ -459,6 +575,7 @@ namespace rl {
                             ut_beta(param_ut_beta),              
                             ut_kappa(param_ut_kappa),              
                             use_linear_evaluation(param_use_linear_evaluation),
+                            use_square_root_update(false),
                             theta(param),
                             theta_size(theta->size),
                             theta_bound(2*theta->size+1),
@@ -471,7 +588,8 @@ namespace rl {
                             P_theta_r(gsl_vector_alloc(theta_size)),
                             kalmanGain(gsl_vector_alloc(theta_size)),
                             centeredSP(gsl_vector_alloc(theta_size)),
-                            q(fct_q) {
+                            q(fct_q),
+                            pool() {
 
                                 std::uniform_real_distribution<> dis(-random_amplitude, random_amplitude);
                                 for(unsigned int i=0;i<theta_size;++i)
@@ -491,6 +609,7 @@ namespace rl {
                             ut_beta(cp.ut_beta),
                             ut_kappa(cp.ut_kappa),
                             use_linear_evaluation(cp.use_linear_evaluation),
+                            use_square_root_update(cp.use_square_root_update),
                             theta(cp.theta),
                             theta_size(cp.theta_size),
                             theta_bound(cp.theta_bound),
@@ -503,7 +622,8 @@ namespace rl {
                             P_theta_r(0),
                             kalmanGain(0),
                             centeredSP(0),
-                            q(cp.q) {
+                            q(cp.q),
+                            pool(cp.pool) {
                                 paramCopy(cp.sigmaTheta,
                                         cp.sigmaPointsSet,
                                         cp.U,
@@ -526,6 +646,7 @@ namespace rl {
                                 ut_beta               = cp.ut_beta;
                                 ut_kappa              = cp.ut_kappa;
                                 use_linear_evaluation = cp.use_linear_evaluation;
+                                use_square_root_update = cp.use_square_root_update;
                                 paramCopy(cp.sigmaTheta,
                                         cp.sigmaPointsSet,
                                         cp.U,
@@ -536,6 +657,7 @@ namespace rl {
                                         cp.kalmanGain,
                                         cp.centeredSP);
                                 q = cp.q;
+                                pool = cp.pool;
                             }
                             return *this;
                         }
@@ -552,6 +674,54 @@ namespace rl {
                             gsl_vector_free(centeredSP);
                         }
 
+                        /**
+                         * The 2n+1 sigma-point images computed at each
+                         * learning step are evaluated concurrently by
+                         * nb_threads threads (the caller included). The
+                         * parametrized q function (and nextValue) must
+                         * then be callable from several threads at
+                         * once, as rl::gsl::mlp networks are. Use 1 for
+                         * the sequential evaluation (default). Copies of
+                         * the critic share the threads.
+                         */
+                        void parallel_evaluation(unsigned int nb_threads) {
+                            if(nb_threads > 1)
+                                pool = std::make_shared<rl::ThreadPool>(nb_threads);
+                            else
+                                pool.reset();
+                        }
+
+                        /**
+                         * This adds the same state as operator<<
+                         * (the unscented weights, theta, its
+                         * covariance factor and the sigma points) to
+                         * a binary snapshot, names being prefixed by
+                         * prefix.
+                         */
+                        void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                            writer.add(prefix + "w_m0",           w_m0);
+                            writer.add(prefix + "w_c0",           w_c0);
+                            writer.add(prefix + "w_i",            w_i);
+                            writer.add(prefix + "theta",          theta);
+                            writer.add(prefix + "sigmaTheta",     sigmaTheta);
+                            writer.add(prefix + "sigmaPointsSet", sigmaPointsSet);
+                        }
+
+                        /**
+                         * This restores the state written by
+                         * write(writer, prefix). The arrays are copied
+                         * into the ones of the critic (theta
+                         * included), so their sizes must match.
+                         */
+                        void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                            mapping.copy(prefix + "theta",          theta);
+                            mapping.copy(prefix + "sigmaTheta",     sigmaTheta);
+                            mapping.copy(prefix + "sigmaPointsSet", sigmaPointsSet);
+                            w_m0 = mapping.scalar(prefix + "w_m0");
+                            w_c0 = mapping.scalar(prefix + "w_c0");
+                            w_i  = mapping.scalar(prefix + "w_i");
+                        }
+
                         double operator()(const STATE &s, const ACTION &a) const {
                             unsigned int i;
                             double pred_r;
@@ -27,14 +27,132 @@
 #pragma once
 
 #include <rlTypes.hpp>
+#include <rlException.hpp>
+#include <rlThreadPool.hpp>
+#include <rlSparse.hpp>
+#include <rlSnapshot.hpp>
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_linalg.h>
 #include <iostream>
+#include <iterator>
+#include <vector>
+#include <memory>
+#include <cstddef>
 
 
 namespace rl {
 
+    /**
+     * @short This adds the contribution of the transitions to the LSTD system M.theta = b.
+     *
+     * M += sum_t phi_t (phi_t - gamma phi'_t)^T and b += sum_t r_t
+     * phi_t, phi' being null for terminal transitions. With a
+     * block_size of 1, M receives one rank-one update per transition,
+     * which is memory-bound. Otherwise, the features of block_size
+     * transitions are first gathered as the rows of two matrices X
+     * and Y (with Y = X - gamma X'), and M += X^T.Y is a single dgemm
+     * per block, which is where an optimized BLAS pays off. This costs
+     * two block_size x n buffers.
+     */
+    template<typename fctGRAD_V_PARAMETRIZED,
+        typename fctCurrentOf,
+        typename fctNextOf,
+        typename fctRewardOf, 
+        typename fctIsTerminal,
+        typename TRANSITION_ITERATOR>
+            void lstd_accumulate(gsl_matrix* M,
+                    gsl_vector* b,
+                    gsl_vector* theta,
+                    double gamma_coef,
+                    const TRANSITION_ITERATOR& trans_begin,
+                    const TRANSITION_ITERATOR& trans_end,
+                    const fctGRAD_V_PARAMETRIZED& fct_grad_v,
+                    const fctCurrentOf& current_of,
+                    const fctNextOf& next_of,
+                    const fctRewardOf& reward_of,
+                    const fctIsTerminal& is_terminal,
+                    std::size_t block_size) {
+
+                int n = theta->size;
+
+                if(block_size <= 1) {
+                    gsl_vector *tmp1   = gsl_vector_calloc(n);
+                    gsl_vector *tmp2   = gsl_vector_calloc(n);
+                    try {
+                        for(auto i=trans_begin; i!=trans_end; ++i) {
+                            const auto& t = *i;
+                            fct_grad_v(theta,tmp1,current_of(t));
+                            gsl_blas_dger(1, tmp1, tmp1, M);
+                            if(!is_terminal(t)) {
+                                fct_grad_v(theta,tmp2,next_of(t));
+                                gsl_blas_dger(-gamma_coef, tmp1, tmp2, M);
+                            }
+                            gsl_blas_daxpy(reward_of(t), tmp1, b); 
+                        }
+                    }
+                    catch(...) {
+                        gsl_vector_free(tmp2);
+                        gsl_vector_free(tmp1);
+                        throw;
+                    }
+                    gsl_vector_free(tmp2);
+                    gsl_vector_free(tmp1);
+                    return;
+                }
+
+                gsl_matrix *X = gsl_matrix_alloc(block_size, n);
+                gsl_matrix *Y = gsl_matrix_alloc(block_size, n);
+                gsl_vector *r = gsl_vector_alloc(block_size);
+                std::size_t k = 0;
+
+                auto flush = [X,Y,r,M,b,n,&k]() {
+                    if(k == 0)
+                        return;
+                    gsl_matrix_const_view Xk = gsl_matrix_const_submatrix(X, 0, 0, k, n);
+                    gsl_matrix_const_view Yk = gsl_matrix_const_submatrix(Y, 0, 0, k, n);
+                    gsl_vector_const_view rk = gsl_vector_const_subvector(r, 0, k);
+                    gsl_blas_dgemm(CblasTrans, CblasNoTrans, 1, &(Xk.matrix), &(Yk.matrix), 1, M);
+                    gsl_blas_dgemv(CblasTrans, 1, &(Xk.matrix), &(rk.vector), 1, b);
+                    k = 0;
+                };
+
+                try {
+                    for(auto i=trans_begin; i!=trans_end; ++i) {
+                        const auto& t = *i;
+                        gsl_vector_view x = gsl_matrix_row(X, k);
+                        gsl_vector_view y = gsl_matrix_row(Y, k);
+                        fct_grad_v(theta,&(x.vector),current_of(t));
+                        if(is_terminal(t))
+                            gsl_vector_memcpy(&(y.vector),&(x.vector));
+                        else {
+                            // y = x - gamma x'
+                            fct_grad_v(theta,&(y.vector),next_of(t));
+                            gsl_vector_scale(&(y.vector),-gamma_coef);
+                            gsl_vector_add(&(y.vector),&(x.vector));
+                        }
+                        gsl_vector_set(r, k, reward_of(t));
+                        if(++k == block_size)
+                            flush();
+                    }
+                    flush();
+                }
+                catch(...) {
+                    gsl_vector_free(r);
+                    gsl_matrix_free(Y);
+                    gsl_matrix_free(X);
+                    throw;
+                }
+                gsl_vector_free(r);
+                gsl_matrix_free(Y);
+                gsl_matrix_free(X);
+            }
+
+    /**
+     * @param block_size the number of transitions whose features are
+     * gathered before updating the LSTD matrix by a single matrix
+     * product (see rl::lstd_accumulate). 1 means rank-one updates.
+     */
     template<typename fctGRAD_V_PARAMETRIZED,
         typename fctCurrentOf,
         typename fctNextOf,
@@ -50,41 +168,311 @@ namespace rl {
                     const fctCurrentOf& current_of,
                     const fctNextOf& next_of,
                     const fctRewardOf& reward_of,
-                    const fctIsTerminal& is_terminal) {
+                    const fctIsTerminal& is_terminal,
+                    std::size_t block_size) {
 
                 int n = theta->size;
                 int signum;
                 gsl_matrix *M      = gsl_matrix_calloc(n, n);
                 gsl_vector *b      = gsl_vector_calloc(n);
-                gsl_vector *tmp1   = gsl_vector_calloc(n);
-                gsl_vector *tmp2   = gsl_vector_calloc(n);
                 gsl_permutation *p = gsl_permutation_alloc(n);
 
                 gsl_matrix_set_identity(M);
                 gsl_matrix_scale(M,reg_coef);
 
-                for(auto i=trans_begin; i!=trans_end; ++i) {
-                    const auto& t = *i;
-                    fct_grad_v(theta,tmp1,current_of(t));
-                    gsl_blas_dger(1, tmp1, tmp1, M);
-                    if(!is_terminal(t)) {
-                        fct_grad_v(theta,tmp2,next_of(t));
-                        gsl_blas_dger(-gamma_coef, tmp1, tmp2, M);
+                try {
+                    lstd_accumulate(M, b, theta, gamma_coef,
+                            trans_begin, trans_end,
+                            fct_grad_v, current_of, next_of, reward_of, is_terminal,
+                            block_size);
+                }
+                catch(...) {
+                    gsl_permutation_free (p);
+                    gsl_matrix_free(M);
+                    gsl_vector_free(b);
+                    throw;
+                }
+
+                // Inversion of M
+                gsl_linalg_LU_decomp (M, p, &signum);
+                gsl_linalg_LU_solve (M, p, b, theta);
+
+                gsl_permutation_free (p);
+                gsl_matrix_free(M);
+                gsl_vector_free(b);
+            }
+
+    template<typename fctGRAD_V_PARAMETRIZED,
+        typename fctCurrentOf,
+        typename fctNextOf,
+        typename fctRewardOf, 
+        typename fctIsTerminal,
+        typename TRANSITION_ITERATOR>
+            void lstd(gsl_vector* theta,
+                    double gamma_coef,
+                    double reg_coef,
+                    const TRANSITION_ITERATOR& trans_begin,
+                    const TRANSITION_ITERATOR& trans_end,
+                    const fctGRAD_V_PARAMETRIZED& fct_grad_v,
+                    const fctCurrentOf& current_of,
+                    const fctNextOf& next_of,
+                    const fctRewardOf& reward_of,
+                    const fctIsTerminal& is_terminal) {
+                lstd(theta, gamma_coef, reg_coef,
+                        trans_begin, trans_end,
+                        fct_grad_v, current_of, next_of, reward_of, is_terminal,
+                        1);
+            }
+
+    /**
+     * @short This is lstd, the accumulation of M and b being shared out among threads.
+     *
+     * The transition range is split into nb_threads contiguous
+     * chunks. Each thread accumulates its own M and b on its chunk,
+     * and the partial sums are then added before the LU solve. This
+     * needs nb_threads n x n matrices, and fct_grad_v (as well as
+     * current_of, next_of, reward_of and is_terminal) must be
+     * callable from several threads at once. The result only differs
+     * from lstd's by the rounding of the sums, and it is the same for
+     * a given nb_threads. 0 threads means
+     * std::thread::hardware_concurrency(). Each thread accumulates by
+     * blocks of block_size transitions (see rl::lstd_accumulate).
+     */
+    template<typename fctGRAD_V_PARAMETRIZED,
+        typename fctCurrentOf,
+        typename fctNextOf,
+        typename fctRewardOf, 
+        typename fctIsTerminal,
+        typename TRANSITION_ITERATOR>
+            void parallel_lstd(gsl_vector* theta,
+                    double gamma_coef,
+                    double reg_coef,
+                    const TRANSITION_ITERATOR& trans_begin,
+                    const TRANSITION_ITERATOR& trans_end,
+                    const fctGRAD_V_PARAMETRIZED& fct_grad_v,
+                    const fctCurrentOf& current_of,
+                    const fctNextOf& next_of,
+                    const fctRewardOf& reward_of,
+                    const fctIsTerminal& is_terminal,
+                    unsigned int nb_threads,
+                    std::size_t block_size = 1) {
+
+                int n = theta->size;
+                int signum;
+                rl::ThreadPool pool(nb_threads);
+                unsigned int nb_chunks = pool.size();
+
+                std::vector<gsl_matrix*> Ms(nb_chunks, nullptr);
+                std::vector<gsl_vector*> bs(nb_chunks, nullptr);
+                for(unsigned int c = 0; c < nb_chunks; ++c) {
+                    Ms[c] = gsl_matrix_calloc(n, n);
+                    bs[c] = gsl_vector_calloc(n);
+                }
+
+                try {
+                    pool.for_each_chunk(trans_begin, trans_end,
+                            [&](const TRANSITION_ITERATOR& first, const TRANSITION_ITERATOR& last, unsigned int c) {
+                                lstd_accumulate(Ms[c], bs[c], theta, gamma_coef,
+                                        first, last,
+                                        fct_grad_v, current_of, next_of, reward_of, is_terminal,
+                                        block_size);
+                            });
+                }
+                catch(...) {
+                    for(unsigned int c = 0; c < nb_chunks; ++c) {
+                        gsl_matrix_free(Ms[c]);
+                        gsl_vector_free(bs[c]);
                     }
-                    gsl_blas_daxpy(reward_of(t), tmp1, b); 
+                    throw;
+                }
+
+                // Reduction, in a fixed order.
+                gsl_matrix *M      = Ms[0];
+                gsl_vector *b      = bs[0];
+                gsl_permutation *p = gsl_permutation_alloc(n);
+                for(unsigned int c = 1; c < nb_chunks; ++c) {
+                    gsl_matrix_add(M, Ms[c]);
+                    gsl_vector_add(b, bs[c]);
+                    gsl_matrix_free(Ms[c]);
+                    gsl_vector_free(bs[c]);
                 }
+                for(int k = 0; k < n; ++k)
+                    *(gsl_matrix_ptr(M, k, k)) += reg_coef;
 
                 // Inversion of M
                 gsl_linalg_LU_decomp (M, p, &signum);
                 gsl_linalg_LU_solve (M, p, b, theta);
 
-                gsl_vector_free(tmp2);
-                gsl_vector_free(tmp1);	
                 gsl_permutation_free (p);
                 gsl_matrix_free(M);
                 gsl_vector_free(b);
             }
 
+    /**
+     * @short This is lstd for sparse features (tabular, tile coding...).
+     *
+     * fct_grad_v(theta, sparse_grad, z) fills a rl::gsl::SparseVector.
+     * The LSTD matrix is accumulated as a rl::gsl::SparseMatrix, so
+     * that the memory is proportional to its non null entries rather
+     * than n^2, and the system is solved by rl::gsl::bicgstab. theta
+     * is the initial guess of the solver, so that the previous
+     * solution can be reused in a policy iteration loop.
+     * @param tol the relative residual where the solver stops.
+     * @param max_iter the maximal number of solver iterations.
+     * @return the number of solver iterations.
+     */
+    template<typename fctGRAD_V_PARAMETRIZED,
+        typename fctCurrentOf,
+        typename fctNextOf,
+        typename fctRewardOf, 
+        typename fctIsTerminal,
+        typename TRANSITION_ITERATOR>
+            std::size_t sparse_lstd(gsl_vector* theta,
+                    double gamma_coef,
+                    double reg_coef,
+                    const TRANSITION_ITERATOR& trans_begin,
+                    const TRANSITION_ITERATOR& trans_end,
+                    const fctGRAD_V_PARAMETRIZED& fct_grad_v,
+                    const fctCurrentOf& current_of,
+                    const fctNextOf& next_of,
+                    const fctRewardOf& reward_of,
+                    const fctIsTerminal& is_terminal,
+                    double tol,
+                    std::size_t max_iter) {
+
+                std::size_t n = theta->size;
+                rl::gsl::SparseMatrix M(n, n);
+                rl::gsl::SparseVector phi(n);
+                rl::gsl::SparseVector phi_next(n);
+                gsl_vector *b = gsl_vector_calloc(n);
+                std::size_t nb_iter;
+
+                try {
+                    if(reg_coef != 0)
+                        for(std::size_t i = 0; i < n; ++i)
+                            M.add(i, i, reg_coef);
+
+                    for(auto i=trans_begin; i!=trans_end; ++i) {
+                        const auto& t = *i;
+                        phi.clear();
+                        fct_grad_v(theta,phi,current_of(t));
+                        M.add_outer(1, phi, phi);
+                        if(!is_terminal(t)) {
+                            phi_next.clear();
+                            fct_grad_v(theta,phi_next,next_of(t));
+                            M.add_outer(-gamma_coef, phi, phi_next);
+                        }
+                        phi.axpy(reward_of(t), b);
+                    }
+                    M.compress();
+
+                    nb_iter = rl::gsl::bicgstab(M, b, theta, tol, max_iter);
+                }
+                catch(...) {
+                    gsl_vector_free(b);
+                    throw;
+                }
+
+                gsl_vector_free(b);
+                return nb_iter;
+            }
+
+    /**
+     * @return the bytes allocated by rl::lstd (block_size) or by
+     * rl::parallel_lstd (block_size, nb_threads) for n features, so
+     * that feature sets can be sized against the available memory.
+     */
+    inline std::size_t lstd_memory_footprint(std::size_t n,
+            std::size_t block_size = 1,
+            unsigned int nb_threads = 1) {
+        std::size_t per_thread = n*n + n;
+        if(block_size <= 1)
+            per_thread += 2*n;
+        else
+            per_thread += 2*block_size*n + block_size;
+        return nb_threads*per_thread*sizeof(double) + n*sizeof(std::size_t);
+    }
+
+    namespace gsl {
+
+        /**
+         * @short The buffers of the recursive LSTD algorithms.
+         *
+         * For n features, this is the n x n matrix C, that estimates
+         * the inverse of the LSTD matrix, and five n-dimensional
+         * vectors. rl::rlstd, rl::rlstd_lambda, rl::gsl::LSTDQ and
+         * rl::gsl::LSTDQ_Lambda can be given a workspace allocated
+         * beforehand, which can then be reused from one run to
+         * another.
+         */
+        class RLSTDWorkspace {
+
+            public:
+
+                gsl_matrix* C;
+                gsl_vector* b;
+                gsl_vector* e_t;
+                gsl_vector* phi_t;
+                gsl_vector* vtmp1;
+                gsl_vector* vtmp2;
+
+                RLSTDWorkspace(std::size_t n)
+                    : C(gsl_matrix_alloc(n, n)),
+                      b(gsl_vector_alloc(n)),
+                      e_t(gsl_vector_alloc(n)),
+                      phi_t(gsl_vector_alloc(n)),
+                      vtmp1(gsl_vector_alloc(n)),
+                      vtmp2(gsl_vector_alloc(n)) {}
+
+                RLSTDWorkspace(const RLSTDWorkspace& cp) = delete;
+                RLSTDWorkspace& operator=(const RLSTDWorkspace& cp) = delete;
+
+                ~RLSTDWorkspace() {
+                    gsl_vector_free(vtmp2);
+                    gsl_vector_free(vtmp1);
+                    gsl_vector_free(phi_t);
+                    gsl_vector_free(e_t);
+                    gsl_vector_free(b);
+                    gsl_matrix_free(C);
+                }
+
+                std::size_t size(void) const {
+                    return b->size;
+                }
+
+                /**
+                 * This sets C to reg_coef.I, b and e_t to 0, for a new run.
+                 */
+                void reset(double reg_coef) {
+                    gsl_matrix_set_identity(C);
+                    gsl_matrix_scale(C, reg_coef);
+                    gsl_vector_set_zero(b);
+                    gsl_vector_set_zero(e_t);
+                }
+
+                /**
+                 * @return the bytes allocated for n features.
+                 */
+                static std::size_t memory_footprint(std::size_t n) {
+                    return (n*n + 5*n)*sizeof(double);
+                }
+
+                std::size_t memory_footprint(void) const {
+                    return memory_footprint(size());
+                }
+
+                void check(const gsl_vector* theta, const std::string& comment) const {
+                    if(theta->size != size())
+                        throw rl::exception::BadVectorSize(theta->size, size(), comment);
+                }
+        };
+    }
+
+    /**
+     * @short recursive LSTD, using Sherman-Morrison updates of the
+     *        inverse of the LSTD matrix. The buffers are taken from ws,
+     *        when it is given (see rl::gsl::RLSTDWorkspace).
+     */
     template<typename fctPHI_PARAMETRIZED,
         typename fctCurrentOf,
         typename fctNextOf,
@@ -100,22 +488,19 @@ namespace rl {
                     const fctCurrentOf& current_of,
                     const fctNextOf& next_of,
                     const fctRewardOf& reward_of,
-                    const fctIsTerminal& is_terminal) {
-
-                int n = theta->size;
-                gsl_matrix *C      = gsl_matrix_calloc(n, n);
-                gsl_vector *b      = gsl_vector_calloc(n);
+                    const fctIsTerminal& is_terminal,
+                    rl::gsl::RLSTDWorkspace& ws) {
 
-                gsl_vector *phi_t  = gsl_vector_alloc(n); 
-                gsl_vector *vtmp1  = gsl_vector_alloc(n);
-                gsl_vector *vtmp2  = gsl_vector_alloc(n);
-                gsl_matrix *mtmp1  = gsl_matrix_alloc(n, n);
+                ws.check(theta, "rl::rlstd workspace");
+                ws.reset(reg_coef);
+                gsl_matrix *C      = ws.C;
+                gsl_vector *b      = ws.b;
+                gsl_vector *phi_t  = ws.phi_t;
+                gsl_vector *vtmp1  = ws.vtmp1;
+                gsl_vector *vtmp2  = ws.vtmp2;
 
                 double norm_coef;
 
-                gsl_matrix_set_identity(C);
-                gsl_matrix_scale(C, reg_coef);
-
                 for(auto i=trans_begin; i!=trans_end; ++i) {
                     const auto& t = *i;
                     // phi_t = Phi(t)
@@ -153,20 +538,38 @@ namespace rl {
                 }  
                 // theta = C * b
                 gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., theta); 
+            }
 
-                gsl_matrix_free(mtmp1);
-                gsl_vector_free(vtmp2);
-                gsl_vector_free(vtmp1);
-                gsl_vector_free(phi_t);
-                gsl_vector_free(b);
-                gsl_matrix_free(C);
+    template<typename fctPHI_PARAMETRIZED,
+        typename fctCurrentOf,
+        typename fctNextOf,
+        typename fctRewardOf, 
+        typename fctIsTerminal,
+        typename TRANSITION_ITERATOR>
+            void rlstd(gsl_vector* theta,
+                    double gamma_coef,
+                    double reg_coef,
+                    const TRANSITION_ITERATOR& trans_begin,
+                    const TRANSITION_ITERATOR& trans_end,
+                    const fctPHI_PARAMETRIZED& fct_phi,
+                    const fctCurrentOf& current_of,
+                    const fctNextOf& next_of,
+                    const fctRewardOf& reward_of,
+                    const fctIsTerminal& is_terminal) {
+                rl::gsl::RLSTDWorkspace ws(theta->size);
+                rlstd(theta, gamma_coef, reg_coef,
+                        trans_begin, trans_end,
+                        fct_phi, current_of, next_of, reward_of, is_terminal,
+                        ws);
             }
 
 
     /**
      * @short State-less one shot application of recursive LSTD
      *        Compared to lstd it makes use of Sherman Morison 
-     *        to iteratively builds up the matrix inverse LSTD involves
+     *        to iteratively builds up the matrix inverse LSTD involves.
+     *        The buffers are taken from ws, when it is given (see
+     *        rl::gsl::RLSTDWorkspace).
      */
     template<typename fctPHI_PARAMETRIZED,
         typename fctCurrentOf,
@@ -184,23 +587,20 @@ namespace rl {
                     const fctCurrentOf& current_of,
                     const fctNextOf& next_of,
                     const fctRewardOf& reward_of,
-                    const fctIsTerminal& is_terminal) {
-
-                int n = theta->size;
-                gsl_matrix *C      = gsl_matrix_calloc(n, n);
-                gsl_vector *b      = gsl_vector_calloc(n);
-
-                gsl_vector *e_t    = gsl_vector_calloc(n);
-                gsl_vector *phi_t  = gsl_vector_calloc(n); 
-                gsl_vector *vtmp1  = gsl_vector_calloc(n);
-                gsl_vector *vtmp2  = gsl_vector_calloc(n);
-                gsl_matrix *mtmp1  = gsl_matrix_calloc(n, n);
+                    const fctIsTerminal& is_terminal,
+                    rl::gsl::RLSTDWorkspace& ws) {
+
+                ws.check(theta, "rl::rlstd_lambda workspace");
+                ws.reset(reg_coef);
+                gsl_matrix *C      = ws.C;
+                gsl_vector *b      = ws.b;
+                gsl_vector *e_t    = ws.e_t;
+                gsl_vector *phi_t  = ws.phi_t;
+                gsl_vector *vtmp1  = ws.vtmp1;
+                gsl_vector *vtmp2  = ws.vtmp2;
 
                 double norm_coef;
 
-                gsl_matrix_set_identity(C);
-                gsl_matrix_scale(C, reg_coef);
-
                 for(auto i=trans_begin; i!=trans_end; ++i) {
                     const auto& t = *i;
                     // phi_t = Phi(t)
@@ -243,14 +643,30 @@ namespace rl {
 
                 // theta = C * b
                 gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., theta);
+            }
 
-                gsl_matrix_free(mtmp1);
-                gsl_vector_free(vtmp2);
-                gsl_vector_free(vtmp1);
-                gsl_vector_free(phi_t);
-                gsl_vector_free(e_t);
-                gsl_vector_free(b);
-                gsl_matrix_free(C);
+    template<typename fctPHI_PARAMETRIZED,
+        typename fctCurrentOf,
+        typename fctNextOf,
+        typename fctRewardOf, 
+        typename fctIsTerminal,
+        typename TRANSITION_ITERATOR>
+            void rlstd_lambda(gsl_vector* theta,
+                    double gamma_coef,
+                    double reg_coef,
+                    double lambda_coef,
+                    const TRANSITION_ITERATOR& trans_begin,
+                    const TRANSITION_ITERATOR& trans_end,
+                    const fctPHI_PARAMETRIZED& fct_phi,
+                    const fctCurrentOf& current_of,
+                    const fctNextOf& next_of,
+                    const fctRewardOf& reward_of,
+                    const fctIsTerminal& is_terminal) {
+                rl::gsl::RLSTDWorkspace ws(theta->size);
+                rlstd_lambda(theta, gamma_coef, reg_coef, lambda_coef,
+                        trans_begin, trans_end,
+                        fct_phi, current_of, next_of, reward_of, is_terminal,
+                        ws);
             }  
 
     namespace gsl {
@@ -270,15 +686,41 @@ namespace rl {
                     double _gamma;
                     std::function<void(gsl_vector*, const STATE&, const ACTION&)> _phi;
 
+                    // The workspace is owned, unless it is given to the constructor.
+                    std::unique_ptr<RLSTDWorkspace> own_ws;
+                    RLSTDWorkspace* ws;
+
                     gsl_matrix* C;
                     gsl_vector* b;
                     gsl_vector* phi_t;
                     gsl_vector* vtmp1;
                     gsl_vector* vtmp2;
-                    gsl_matrix* mtmp1;
 
                     int _nb_warm_up_transitions;
                     int _nb_accumulated_transitions;
+                    bool _theta_stale;
+
+                    void transition_accumulated(void) {
+                        if(_nb_accumulated_transitions < _nb_warm_up_transitions)
+                            return;
+                        if(theta_period <= 1 || (_nb_accumulated_transitions - _nb_warm_up_transitions) % theta_period == 0) {
+                            // theta = C * b
+                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);
+                            _theta_stale = false;
+                        }
+                        else
+                            _theta_stale = true;
+                    }
+
+                    void init(double reg_coef) {
+                        ws->check(_theta_q, "rl::gsl::LSTDQ workspace");
+                        ws->reset(reg_coef);
+                        C     = ws->C;
+                        b     = ws->b;
+                        phi_t = ws->phi_t;
+                        vtmp1 = ws->vtmp1;
+                        vtmp2 = ws->vtmp2;
+                    }
 
                 public:
                     template<typename fctPhi_sa_parametrized>
@@ -290,25 +732,96 @@ namespace rl {
                             _theta_q(param),
                             _gamma(gamma_coef),
                             _phi(phi_sa),
-                            C(gsl_matrix_calloc(param->size, param->size)),
-                            b(gsl_vector_calloc(param->size)),
-                            phi_t(gsl_vector_calloc(param->size)),
-                            vtmp1(gsl_vector_calloc(param->size)),
-                            vtmp2(gsl_vector_calloc(param->size)),
-                            mtmp1(gsl_matrix_calloc(param->size, param->size)),
+                            own_ws(new RLSTDWorkspace(param->size)),
+                            ws(own_ws.get()),
+                            _nb_warm_up_transitions(nb_warm_up_transitions),
+                            _nb_accumulated_transitions(0),
+                            _theta_stale(false),
+                            theta_period(1) {
+                                init(reg_coef);
+                            }
+
+                    /**
+                     * The buffers are taken from workspace, that must
+                     * outlive the critic and must not be used by
+                     * another one meanwhile.
+                     */
+                    template<typename fctPhi_sa_parametrized>
+                        LSTDQ(gsl_vector* param,
+                                double gamma_coef,
+                                double reg_coef,
+                                int nb_warm_up_transitions,
+                                const fctPhi_sa_parametrized& phi_sa,
+                                RLSTDWorkspace& workspace):
+                            _theta_q(param),
+                            _gamma(gamma_coef),
+                            _phi(phi_sa),
+                            own_ws(),
+                            ws(&workspace),
                             _nb_warm_up_transitions(nb_warm_up_transitions),
-                            _nb_accumulated_transitions(0) {
-                                gsl_matrix_set_identity(C);
-                                gsl_matrix_scale(C, reg_coef);
+                            _nb_accumulated_transitions(0),
+                            _theta_stale(false),
+                            theta_period(1) {
+                                init(reg_coef);
                             }
 
-                    ~LSTDQ() {
-                        gsl_matrix_free(mtmp1);
-                        gsl_vector_free(vtmp2);
-                        gsl_vector_free(vtmp1);
-                        gsl_vector_free(phi_t);
-                        gsl_vector_free(b);
-                        gsl_matrix_free(C);
+                    /**
+                     * After the warm-up, theta = C.b, which costs
+                     * O(n^2), is computed every theta_period
+                     * transitions (1, i.e. at each one, by default).
+                     * In between, theta lags behind the accumulated
+                     * statistics, update_theta() brings it up to
+                     * date.
+                     */
+                    unsigned int theta_period;
+
+                    /**
+                     * This computes theta = C.b if it is stale, e.g.
+                     * before testing the policy or saving theta.
+                     */
+                    void update_theta(void) {
+                        if(_theta_stale) {
+                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);
+                            _theta_stale = false;
+                        }
+                    }
+
+                    bool theta_is_stale(void) const {
+                        return _theta_stale;
+                    }
+
+                    /**
+                     * @return the bytes used by the buffers of a critic with n features.
+                     */
+                    static std::size_t memory_footprint(std::size_t n) {
+                        return RLSTDWorkspace::memory_footprint(n);
+                    }
+
+                    std::size_t memory_footprint(void) const {
+                        return ws->memory_footprint();
+                    }
+
+                    /**
+                     * This adds the accumulated statistics (C and b),
+                     * theta and the number of accumulated transitions
+                     * to a binary snapshot, names being prefixed by
+                     * prefix. Learning can then be resumed from a
+                     * critic restored by read(mapping, prefix).
+                     */
+                    void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                        writer.add(prefix + "C",     C);
+                        writer.add(prefix + "b",     b);
+                        writer.add(prefix + "theta", _theta_q);
+                        writer.add(prefix + "nb_accumulated_transitions", (double)_nb_accumulated_transitions);
+                        writer.add(prefix + "theta_stale", _theta_stale ? 1. : 0.);
+                    }
+
+                    void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                        mapping.copy(prefix + "C",     C);
+                        mapping.copy(prefix + "b",     b);
+                        mapping.copy(prefix + "theta", _theta_q);
+                        _nb_accumulated_transitions = (int)(mapping.scalar(prefix + "nb_accumulated_transitions"));
+                        _theta_stale = mapping.scalar(prefix + "theta_stale") != 0;
                     }
 
                     double td_error (const STATE &s, const ACTION& a, double r, const STATE &s_, const ACTION& a_) {
@@ -366,9 +879,7 @@ namespace rl {
 
                         // If we accumulated a sufficient number of transitions
                         // we begin updating the parameter vector
-                        if(_nb_accumulated_transitions >= _nb_warm_up_transitions)
-                            // theta = C * b
-                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);
+                        transition_accumulated();
                     }
 
                     void learn(const STATE& s, const ACTION& a, double r) {
@@ -396,9 +907,7 @@ namespace rl {
 
                         // If we accumulated a sufficient number of transitions
                         // we begin updating the parameter vector
-                        if(_nb_accumulated_transitions >= _nb_warm_up_transitions)
-                            // theta = C * b
-                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);	
+                        transition_accumulated();
                     }
 
             };
@@ -420,16 +929,43 @@ namespace rl {
                     double _gamma, _lambda;
                     std::function<void(gsl_vector*, const STATE&, const ACTION&)> _phi;
 
+                    // The workspace is owned, unless it is given to the constructor.
+                    std::unique_ptr<RLSTDWorkspace> own_ws;
+                    RLSTDWorkspace* ws;
+
                     gsl_matrix* C;
                     gsl_vector* b;
                     gsl_vector* e_t;
                     gsl_vector* phi_t;
                     gsl_vector* vtmp1;
                     gsl_vector* vtmp2;
-                    gsl_matrix* mtmp1;
 
                     int _nb_warm_up_transitions;
                     int _nb_accumulated_transitions;
+                    bool _theta_stale;
+
+                    void transition_accumulated(void) {
+                        if(_nb_accumulated_transitions < _nb_warm_up_transitions)
+                            return;
+                        if(theta_period <= 1 || (_nb_accumulated_transitions - _nb_warm_up_transitions) % theta_period == 0) {
+                            // theta = C * b
+                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);
+                            _theta_stale = false;
+                        }
+                        else
+                            _theta_stale = true;
+                    }
+
+                    void init(double reg_coef) {
+                        ws->check(_theta_q, "rl::gsl::LSTDQ_Lambda workspace");
+                        ws->reset(reg_coef);
+                        C     = ws->C;
+                        b     = ws->b;
+                        e_t   = ws->e_t;
+                        phi_t = ws->phi_t;
+                        vtmp1 = ws->vtmp1;
+                        vtmp2 = ws->vtmp2;
+                    }
 
                 public:
                     template<typename fctPhi_sa_parametrized>
@@ -442,28 +978,101 @@ namespace rl {
                             _theta_q(param),
                             _gamma(gamma_coef),
                             _lambda(lambda_coef),
+                            _phi(phi_sa),
+                            own_ws(new RLSTDWorkspace(param->size)),
+                            ws(own_ws.get()),
                             _nb_warm_up_transitions(nb_warm_up_transitions),
                             _nb_accumulated_transitions(0),
+                            _theta_stale(false),
+                            theta_period(1) {
+                                init(reg_coef);
+                            }
+
+                    /**
+                     * The buffers are taken from workspace, that must
+                     * outlive the critic and must not be used by
+                     * another one meanwhile.
+                     */
+                    template<typename fctPhi_sa_parametrized>
+                        LSTDQ_Lambda(gsl_vector* param,
+                                double gamma_coef,
+                                double reg_coef,
+                                double lambda_coef,
+                                int nb_warm_up_transitions,
+                                const fctPhi_sa_parametrized& phi_sa,
+                                RLSTDWorkspace& workspace):
+                            _theta_q(param),
+                            _gamma(gamma_coef),
+                            _lambda(lambda_coef),
                             _phi(phi_sa),
-                            C(gsl_matrix_calloc(param->size, param->size)),
-                            b(gsl_vector_calloc(param->size)),
-                            e_t(gsl_vector_calloc(param->size)),
-                            phi_t(gsl_vector_calloc(param->size)),
-                            vtmp1(gsl_vector_calloc(param->size)),
-                            vtmp2(gsl_vector_calloc(param->size)),
-                            mtmp1(gsl_matrix_calloc(param->size, param->size)) {
-                                gsl_matrix_set_identity(C);
-                                gsl_matrix_scale(C, reg_coef);
+                            own_ws(),
+                            ws(&workspace),
+                            _nb_warm_up_transitions(nb_warm_up_transitions),
+                            _nb_accumulated_transitions(0),
+                            _theta_stale(false),
+                            theta_period(1) {
+                                init(reg_coef);
                             }
 
-                    ~LSTDQ_Lambda() {
-                        gsl_matrix_free(mtmp1);
-                        gsl_vector_free(vtmp2);
-                        gsl_vector_free(vtmp1);
-                        gsl_vector_free(phi_t);
-                        gsl_vector_free(e_t);
-                        gsl_vector_free(b);
-                        gsl_matrix_free(C);
+                    /**
+                     * After the warm-up, theta = C.b, which costs
+                     * O(n^2), is computed every theta_period
+                     * transitions (1, i.e. at each one, by default).
+                     * In between, theta lags behind the accumulated
+                     * statistics, update_theta() brings it up to
+                     * date.
+                     */
+                    unsigned int theta_period;
+
+                    /**
+                     * This computes theta = C.b if it is stale, e.g.
+                     * before testing the policy or saving theta.
+                     */
+                    void update_theta(void) {
+                        if(_theta_stale) {
+                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);
+                            _theta_stale = false;
+                        }
+                    }
+
+                    bool theta_is_stale(void) const {
+                        return _theta_stale;
+                    }
+
+                    /**
+                     * @return the bytes used by the buffers of a critic with n features.
+                     */
+                    static std::size_t memory_footprint(std::size_t n) {
+                        return RLSTDWorkspace::memory_footprint(n);
+                    }
+
+                    std::size_t memory_footprint(void) const {
+                        return ws->memory_footprint();
+                    }
+
+                    /**
+                     * This adds the accumulated statistics (C, b and the trace e),
+                     * theta and the number of accumulated transitions
+                     * to a binary snapshot, names being prefixed by
+                     * prefix. Learning can then be resumed from a
+                     * critic restored by read(mapping, prefix).
+                     */
+                    void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                        writer.add(prefix + "C",     C);
+                        writer.add(prefix + "b",     b);
+                        writer.add(prefix + "e",     e_t);
+                        writer.add(prefix + "theta", _theta_q);
+                        writer.add(prefix + "nb_accumulated_transitions", (double)_nb_accumulated_transitions);
+                        writer.add(prefix + "theta_stale", _theta_stale ? 1. : 0.);
+                    }
+
+                    void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                        mapping.copy(prefix + "C",     C);
+                        mapping.copy(prefix + "b",     b);
+                        mapping.copy(prefix + "e",     e_t);
+                        mapping.copy(prefix + "theta", _theta_q);
+                        _nb_accumulated_transitions = (int)(mapping.scalar(prefix + "nb_accumulated_transitions"));
+                        _theta_stale = mapping.scalar(prefix + "theta_stale") != 0;
                     }
 
                     double td_error (const STATE &s, const ACTION& a, double r, const STATE &s_, const ACTION& a_) {
@@ -524,9 +1133,7 @@ namespace rl {
 
                         // If we accumulated a sufficient number of transitions
                         // we begin updating the parameter vector
-                        if(_nb_accumulated_transitions >= _nb_warm_up_transitions)
-                            // theta = C * b
-                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);
+                        transition_accumulated();
                     }
 
                     void learn(const STATE& s, const ACTION& a, double r) {
@@ -559,9 +1166,7 @@ namespace rl {
 
                         // If we accumulated a sufficient number of transitions
                         // we begin updating the parameter vector
-                        if(_nb_accumulated_transitions >= _nb_warm_up_transitions)
-                            // theta = C * b
-                            gsl_blas_dgemv(CblasNoTrans, 1., C, b, 0., _theta_q);	
+                        transition_accumulated();
                     }
 
             };
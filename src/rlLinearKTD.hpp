@@ -0,0 +1,401 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_blas.h>
+#include <cstddef>
+#include <random>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include <rlSparse.hpp>
+#include <rlTraits.hpp>
+#include <rlTypes.hpp>
+#include <rlSnapshot.hpp>
+
+namespace rl {
+
+    namespace gsl {
+
+        /**
+         * @short KTD-SARSA for linear Q-functions, i.e q(theta,s,a) = theta.phi(s,a).
+         *
+         * In that case, the observation r = q(s,a) - gamma*q(s',a') is
+         * linear in theta, the unscented transform is exact, and the
+         * Kalman update has a closed form using h = phi(s,a) -
+         * gamma*phi(s',a'). This engine performs it directly, without
+         * any sigma point. It gives the same estimation as
+         * rl::gsl::KTDSARSA used with use_linear_evaluation, in O(n^2)
+         * per step rather than O(n^3).
+         *
+         * The feature function is either phi(gsl_vector* phi_sa, s, a)
+         * or phi(rl::gsl::SparseVector& phi_sa, s, a). In the sparse
+         * case, P.h is computed in O(n*nnz), the covariance update
+         * remaining O(n^2).
+         *
+         * The evaluations can be given a workspace, that receives h
+         * and P.h. The overloads without a workspace use a
+         * thread_local one, so that the evaluations of a LinearKTD can
+         * be done by several threads at once.
+         */
+        template<typename STATE,
+            typename ACTION,
+            typename fctFEATURE>
+                class LinearKTD {
+                    public:
+
+                        using self_type = LinearKTD<STATE,ACTION,fctFEATURE>;
+
+                        /**
+                         * The scratch memory of the evaluations. It
+                         * is resized on demand.
+                         */
+                        class Workspace {
+                            private:
+
+                                friend class LinearKTD<STATE,ACTION,fctFEATURE>;
+
+                                std::vector<double> h;     // Dense mode only.
+                                std::vector<double> Ph;
+                                SparseVector        sh;
+                                SparseVector        sh_next;
+
+                                void resize(std::size_t n, bool dense) {
+                                    if(dense)
+                                        h.resize(n);
+                                    Ph.resize(n);
+                                    sh.size      = n;
+                                    sh_next.size = n;
+                                }
+
+                            public:
+
+                                Workspace(void) = default;
+                        };
+
+                        using workspace_type = Workspace;
+
+                        double gamma;
+                        double eta_noise;             // default    0
+                        double observation_noise;     // default    1
+
+                    protected:
+
+                        static constexpr bool sparse = rl::traits::gsl::is_sparse_state_action_feature<fctFEATURE,STATE,ACTION>::value;
+
+                        gsl_vector* theta;
+                        unsigned int theta_size;
+                        gsl_matrix* P;     // The covariance of theta.
+                        Workspace ws;      // Used by the learning.
+                        std::conditional_t<sparse,
+                            std::function<void (SparseVector&, const STATE&, const ACTION&)>,
+                            std::function<void (gsl_vector*, const STATE&, const ACTION&)>> phi;
+
+                        void read(std::istream& is) {
+                            is >> theta
+                                >> P;
+                        }
+
+                        void write(std::ostream& os) const {
+                            os << theta
+                                << P;
+                        }
+
+                        friend std::ostream& operator<<(std::ostream& os, const self_type& ktd) {
+                            ktd.write(os);
+                            return os;
+                        }
+
+                        friend std::istream& operator>>(std::istream& is, self_type& ktd) {
+                            ktd.read(is);
+                            return is;
+                        }
+
+                    private:
+
+                        static gsl_vector_view view(std::vector<double>& v) {
+                            return gsl_vector_view_array(v.data(),v.size());
+                        }
+
+                        // ws.h <- phi(s,a) - gamma*phi(s_,a_), the second
+                        // term being omitted for terminal transitions.
+                        void observation(const STATE& s, const ACTION& a,
+                                const STATE& s_, const ACTION& a_,
+                                bool is_terminal,
+                                Workspace& ws) const {
+                            ws.resize(theta_size,!sparse);
+                            if constexpr (sparse) {
+                                ws.sh.clear();
+                                phi(ws.sh,s,a);
+                                if(!is_terminal) {
+                                    ws.sh_next.clear();
+                                    phi(ws.sh_next,s_,a_);
+                                    for(std::size_t k = 0; k < ws.sh_next.nnz(); ++k)
+                                        ws.sh.add(ws.sh_next.index(k),-gamma*ws.sh_next.value(k));
+                                }
+                            }
+                            else {
+                                gsl_vector_view h  = view(ws.h);
+                                gsl_vector_view Ph = view(ws.Ph);
+                                phi(&(h.vector),s,a);
+                                if(!is_terminal) {
+                                    phi(&(Ph.vector),s_,a_);
+                                    gsl_blas_daxpy(-gamma,&(Ph.vector),&(h.vector));
+                                }
+                            }
+                        }
+
+                        // returns h.theta, once observation() has been called.
+                        double value(Workspace& ws) const {
+                            if constexpr (sparse)
+                                return ws.sh.dot(theta);
+                            else {
+                                double res;
+                                gsl_vector_view h = view(ws.h);
+                                gsl_blas_ddot(&(h.vector),theta,&res);
+                                return res;
+                            }
+                        }
+
+                        // ws.Ph <- P.h, returns h.theta
+                        double project(Workspace& ws) const {
+                            gsl_vector_view Ph = view(ws.Ph);
+                            if constexpr (sparse) {
+                                gsl_vector_set_zero(&(Ph.vector));
+                                for(std::size_t k = 0; k < ws.sh.nnz(); ++k) {
+                                    // P is symmetric, so its row is its column.
+                                    gsl_vector_const_view row = gsl_matrix_const_row(P,ws.sh.index(k));
+                                    gsl_blas_daxpy(ws.sh.value(k),&(row.vector),&(Ph.vector));
+                                }
+                            }
+                            else {
+                                gsl_vector_view h = view(ws.h);
+                                gsl_blas_dgemv(CblasNoTrans,1,P,&(h.vector),0,&(Ph.vector));
+                            }
+                            return value(ws);
+                        }
+
+                        // returns h.P.h, once project() has been called.
+                        double variance(Workspace& ws) const {
+                            gsl_vector_view Ph = view(ws.Ph);
+                            if constexpr (sparse)
+                                return ws.sh.dot(&(Ph.vector));
+                            else {
+                                double res;
+                                gsl_vector_view h = view(ws.h);
+                                gsl_blas_ddot(&(h.vector),&(Ph.vector),&res);
+                                return res;
+                            }
+                        }
+
+                        void kalmanUpdate(const STATE& s, const ACTION& a,
+                                double r,
+                                const STATE& s_, const ACTION& a_,
+                                bool is_terminal) {
+                            double pred_r, P_r;
+
+                            // Prediction step
+                            if(eta_noise != 0)
+                                gsl_matrix_scale(P,1+eta_noise);
+
+                            // Statistics of the observation
+                            observation(s,a,s_,a_,is_terminal,ws);
+                            pred_r = project(ws);
+                            P_r    = variance(ws) + observation_noise;
+
+                            // Correction: theta += K(r-pred_r) and
+                            // P -= K.P_r.K^T, with K = P.h/P_r.
+                            gsl_vector_view Ph = view(ws.Ph);
+                            gsl_blas_daxpy((r-pred_r)/P_r,&(Ph.vector),theta);
+                            gsl_blas_dger(-1/P_r,&(Ph.vector),&(Ph.vector),P);
+                        }
+
+                    public:
+
+                        /**
+                         * @param  param                 the parameter theta, its size is the feature dimension.
+                         * @param  f                     the feature function.
+                         * @param  eta_noise             default value is    0
+                         * @param  observation_noise     default value is    1
+                         * @param  prior_var             default value is   10, the prior covariance is prior_var^2 I as in rl::gsl::KTD.
+                         * @param  random_amplitude      default value is    0
+                         * @param  gen                   random device used to initialize the parameters (e.g. std::mt19937) 
+                         */
+                        template<typename RANDOM_GENERATOR>
+                            LinearKTD(gsl_vector* param,
+                                    const fctFEATURE& f,
+                                    double param_gamma,
+                                    double param_eta_noise,    
+                                    double param_observation_noise,  
+                                    double param_prior_var,            
+                                    double param_random_amplitude,       
+                                    RANDOM_GENERATOR& gen) 
+                            : gamma(param_gamma),
+                            eta_noise(param_eta_noise),    
+                            observation_noise(param_observation_noise),  
+                            theta(param),
+                            theta_size(theta->size),
+                            P(gsl_matrix_alloc(theta_size,theta_size)),
+                            ws(),
+                            phi(f) {
+                                std::uniform_real_distribution<> dis(-param_random_amplitude, param_random_amplitude);
+                                for(unsigned int i=0;i<theta_size;++i)
+                                    gsl_vector_set(theta,i,dis(gen));
+                                gsl_matrix_set_identity(P);
+                                gsl_matrix_scale(P,param_prior_var*param_prior_var);
+                            }
+
+                        LinearKTD(const self_type& cp) 
+                            : gamma(cp.gamma),
+                            eta_noise(cp.eta_noise),
+                            observation_noise(cp.observation_noise),
+                            theta(cp.theta),
+                            theta_size(cp.theta_size),
+                            P(gsl_matrix_alloc(cp.theta_size,cp.theta_size)),
+                            ws(),
+                            phi(cp.phi) {
+                                gsl_matrix_memcpy(P,cp.P);
+                            }
+
+                        self_type& operator=(const self_type& cp) {
+                            if(this != &cp) {
+                                gamma             = cp.gamma;
+                                eta_noise         = cp.eta_noise;
+                                observation_noise = cp.observation_noise;
+                                theta             = cp.theta;
+                                if(theta_size != cp.theta_size) {
+                                    theta_size = cp.theta_size;
+                                    gsl_matrix_free(P);
+                                    P  = gsl_matrix_alloc(theta_size,theta_size);
+                                }
+                                gsl_matrix_memcpy(P,cp.P);
+                                phi = cp.phi;
+                            }
+                            return *this;
+                        }
+
+                        ~LinearKTD(void) {
+                            gsl_matrix_free(P);
+                        }
+
+                        /**
+                         * This adds theta and its covariance to a
+                         * binary snapshot, names being prefixed by
+                         * prefix.
+                         */
+                        void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                            writer.add(prefix + "theta", theta);
+                            writer.add(prefix + "P",     P);
+                        }
+
+                        /**
+                         * This copies back the arrays saved by write(writer, prefix).
+                         */
+                        void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                            mapping.copy(prefix + "theta", theta);
+                            mapping.copy(prefix + "P",     P);
+                        }
+
+                        /**
+                         * @return a workspace for the evaluations.
+                         */
+                        workspace_type workspace(void) const {
+                            workspace_type res;
+                            res.resize(theta_size,!sparse);
+                            return res;
+                        }
+
+                        double operator()(const STATE &s, const ACTION &a, workspace_type& w) const {
+                            observation(s,a,s,a,true,w);
+                            return value(w);
+                        }
+
+                        double operator()(const STATE &s, const ACTION &a) const {
+                            thread_local workspace_type w;
+                            return (*this)(s,a,w);
+                        }
+
+                        double operator()(const STATE &s, const ACTION &a, double& var, workspace_type& w) const {
+                            double res;
+                            observation(s,a,s,a,true,w);
+                            res = project(w);
+                            var = variance(w);
+                            return res;
+                        }
+
+                        double operator()(const STATE &s, const ACTION &a, double& var) const {
+                            thread_local workspace_type w;
+                            return (*this)(s,a,var,w);
+                        }
+
+                        void learn(const STATE& s,
+                                const ACTION& a,
+                                double r) {
+                            kalmanUpdate(s,a,r,s,a,true);
+                        }
+
+                        void learn(const STATE& s,
+                                const ACTION& a,
+                                double r,
+                                const STATE& s_,
+                                const ACTION& a_) {
+                            kalmanUpdate(s,a,r,s_,a_,false);
+                        }
+                };
+
+        /**
+         * @param  eta_noise             default value is    0
+         * @param  observation_noise     default value is    1
+         * @param  prior_var             default value is   10
+         * @param  random_amplitude      default value is    0
+         * @param  gen                   random device used to initialize the parameters (e.g. std::mt19937) 
+         */
+        template<typename STATE,
+            typename ACTION,
+            typename fctFEATURE,
+            typename RANDOM_GENERATOR>
+                LinearKTD<STATE,ACTION,fctFEATURE> linear_ktd(gsl_vector* param,
+                        const fctFEATURE& f,
+                        double param_gamma,
+                        double param_eta_noise,    
+                        double param_observation_noise,  
+                        double param_prior_var,            
+                        double param_random_amplitude,       
+                        RANDOM_GENERATOR& gen) {
+                    return LinearKTD<STATE,ACTION,fctFEATURE>(param,f,
+                            param_gamma,
+                            param_eta_noise,    
+                            param_observation_noise,  
+                            param_prior_var,            
+                            param_random_amplitude,       
+                            gen);
+                }
+    }
+}
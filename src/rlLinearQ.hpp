@@ -0,0 +1,259 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_blas.h>
+
+#include <rlException.hpp>
+
+namespace rl {
+
+    namespace gsl {
+
+        /**
+         * @short Linear Q-function, with one block of parameters per action.
+         *
+         * Q(theta,s,a) = theta_a^T.phi(s), where theta is the
+         * concatenation of the theta_a, in the order of the action
+         * iterators, and phi(s) is a feature vector of the state
+         * only. Such an architecture can compute Q(s,a) for all the
+         * actions by computing phi(s) once, followed by a single
+         * matrix-vector product: this is what q_all does, and it is
+         * used by rl::argmax and the policies (see
+         * rl::traits::has_q_all).
+         *
+         * The evaluations can be given a workspace, that receives
+         * phi(s). The overloads without a workspace use a thread_local
+         * one, so that a LinearQ can be used by several threads at
+         * once.
+         */
+        template<typename STATE,
+            typename ACTION_ITERATOR>
+            class LinearQ {
+
+                public:
+
+                    using phi_type       = std::function<void (gsl_vector*, const STATE&)>;
+                    using workspace_type = std::vector<double>;
+
+                private:
+
+                    const gsl_vector* theta;
+                    phi_type          phi;
+                    ACTION_ITERATOR   a_begin, a_end;
+                    std::size_t       nb_actions;
+                    std::size_t       phi_dim;
+
+                    // phi(s) is computed in ws.
+                    const gsl_vector* features(const STATE& s, workspace_type& ws, gsl_vector_view& phi_s) const {
+                        ws.resize(phi_dim);
+                        phi_s = gsl_vector_view_array(&(*(ws.begin())), phi_dim);
+                        phi(&(phi_s.vector), s);
+                        return &(phi_s.vector);
+                    }
+
+                    template<typename ACTION>
+                        std::size_t rank(const ACTION& a) const {
+                            auto it = std::find(a_begin, a_end, a);
+                            if(it == a_end)
+                                throw rl::exception::Any("in rl::gsl::LinearQ : unknown action");
+                            return std::distance(a_begin, it);
+                        }
+
+                public:
+
+                    LinearQ(void) = delete;
+
+                    /**
+                     * @param param theta, of size nb_actions*phi_dimension.
+                     * @param fct_phi fct_phi(phi,s) writes the state features in phi.
+                     * @param phi_dimension the dimension of the state features.
+                     */
+                    template<typename fctPHI>
+                        LinearQ(const gsl_vector* param,
+                                const fctPHI& fct_phi,
+                                std::size_t phi_dimension,
+                                const ACTION_ITERATOR& action_begin,
+                                const ACTION_ITERATOR& action_end)
+                        : theta(param), phi(fct_phi),
+                        a_begin(action_begin), a_end(action_end),
+                        nb_actions(std::distance(action_begin, action_end)),
+                        phi_dim(phi_dimension) {
+                            if(theta->size != nb_actions*phi_dimension)
+                                throw rl::exception::BadVectorSize(theta->size, nb_actions*phi_dimension,
+                                        "in rl::gsl::LinearQ : theta must have nb_actions*phi_dimension components");
+                        }
+
+                    LinearQ(const LinearQ<STATE,ACTION_ITERATOR>& cp)
+                        : theta(cp.theta), phi(cp.phi),
+                        a_begin(cp.a_begin), a_end(cp.a_end),
+                        nb_actions(cp.nb_actions),
+                        phi_dim(cp.phi_dim) {}
+
+                    LinearQ<STATE,ACTION_ITERATOR>& operator=(const LinearQ<STATE,ACTION_ITERATOR>& cp) = delete;
+
+                    /**
+                     * @return a workspace for the evaluations.
+                     */
+                    workspace_type workspace(void) const {
+                        return workspace_type(phi_dim);
+                    }
+
+                    /**
+                     * @return Q(theta,s,a).
+                     */
+                    template<typename ACTION>
+                        double operator()(const STATE& s, const ACTION& a, workspace_type& ws) const {
+                            double res;
+                            gsl_vector_view phi_s;
+                            const gsl_vector* f = features(s, ws, phi_s);
+                            gsl_vector_const_view theta_a = gsl_vector_const_subvector(theta, rank(a)*phi_dim, phi_dim);
+                            gsl_blas_ddot(&(theta_a.vector), f, &res);
+                            return res;
+                        }
+
+                    template<typename ACTION>
+                        double operator()(const STATE& s, const ACTION& a) const {
+                            thread_local workspace_type ws;
+                            return (*this)(s, a, ws);
+                        }
+
+                    /**
+                     * values[k] <- Q(theta,s,a_k), for the k-th action a_k.
+                     * If theta is not contiguous (e.g. a strided view), a
+                     * dot product is computed for each action.
+                     */
+                    void q_all(const STATE& s, double* values, workspace_type& ws) const {
+                        gsl_vector_view phi_s;
+                        const gsl_vector* f = features(s, ws, phi_s);
+                        if(theta->stride != 1) {
+                            for(std::size_t k = 0; k < nb_actions; ++k) {
+                                gsl_vector_const_view theta_a = gsl_vector_const_subvector(theta, k*phi_dim, phi_dim);
+                                gsl_blas_ddot(&(theta_a.vector), f, values + k);
+                            }
+                            return;
+                        }
+                        gsl_matrix_const_view Theta = gsl_matrix_const_view_vector(theta, nb_actions, phi_dim);
+                        gsl_vector_view       out   = gsl_vector_view_array(values, nb_actions);
+                        gsl_blas_dgemv(CblasNoTrans, 1.0, &(Theta.matrix), f, 0.0, &(out.vector));
+                    }
+
+                    void q_all(const STATE& s, double* values) const {
+                        thread_local workspace_type ws;
+                        q_all(s, values, ws);
+                    }
+            };
+
+        template<typename STATE,
+            typename fctPHI,
+            typename ACTION_ITERATOR>
+            LinearQ<STATE,ACTION_ITERATOR> linear_q(const gsl_vector* param,
+                    const fctPHI& fct_phi,
+                    std::size_t phi_dimension,
+                    const ACTION_ITERATOR& action_begin,
+                    const ACTION_ITERATOR& action_end) {
+                return LinearQ<STATE,ACTION_ITERATOR>(param, fct_phi, phi_dimension, action_begin, action_end);
+            }
+
+        /**
+         * @short Linear parametrized function, q(theta,args...) = theta^T.phi(args...).
+         *
+         * This is the usual parametrized value function of the
+         * critics, e.g Linear<S,A> is q(theta,s,a) = theta^T.phi(s,a)
+         * and Linear<S> is v(theta,s) = theta^T.phi(s). As for LinearQ,
+         * the evaluations can be given a workspace, the overloads
+         * without workspace using a thread_local one, so that a
+         * Linear object can be used by several threads at once.
+         */
+        template<typename... ARGS>
+            class Linear {
+
+                public:
+
+                    using phi_type       = std::function<void (gsl_vector*, const ARGS&...)>;
+                    using workspace_type = std::vector<double>;
+
+                private:
+
+                    phi_type    phi;
+                    std::size_t phi_dim;
+
+                public:
+
+                    Linear(void) = delete;
+
+                    /**
+                     * @param fct_phi fct_phi(phi,args...) writes the features in phi.
+                     * @param phi_dimension the dimension of the features, i.e. of theta.
+                     */
+                    template<typename fctPHI>
+                        Linear(const fctPHI& fct_phi, std::size_t phi_dimension)
+                        : phi(fct_phi), phi_dim(phi_dimension) {}
+
+                    Linear(const Linear<ARGS...>& cp) = default;
+                    Linear<ARGS...>& operator=(const Linear<ARGS...>& cp) = default;
+
+                    workspace_type workspace(void) const {
+                        return workspace_type(phi_dim);
+                    }
+
+                    double operator()(const gsl_vector* theta, const ARGS&... args, workspace_type& ws) const {
+                        double res;
+                        ws.resize(phi_dim);
+                        gsl_vector_view phi_x = gsl_vector_view_array(&(*(ws.begin())), phi_dim);
+                        phi(&(phi_x.vector), args...);
+                        gsl_blas_ddot(theta, &(phi_x.vector), &res);
+                        return res;
+                    }
+
+                    double operator()(const gsl_vector* theta, const ARGS&... args) const {
+                        thread_local workspace_type ws;
+                        return (*this)(theta, args..., ws);
+                    }
+
+                    /**
+                     * grad <- d q(theta,args...) / d theta = phi(args...).
+                     */
+                    void gradient(const gsl_vector* theta, gsl_vector* grad, const ARGS&... args) const {
+                        phi(grad, args...);
+                    }
+            };
+
+        template<typename... ARGS,
+            typename fctPHI>
+            Linear<ARGS...> linear(const fctPHI& fct_phi, std::size_t phi_dimension) {
+                return Linear<ARGS...>(fct_phi, phi_dimension);
+            }
+    }
+}
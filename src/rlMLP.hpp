@@ -33,7 +33,12 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <cstddef>
+#include <algorithm>
 #include <functional>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_blas.h>
 
 namespace rl {
   namespace transfer {
@@ -62,12 +67,58 @@ namespace rl {
 		       double a) {
       return ::tanh(weighted_sum*a);
     } 
+
+    /**
+     * @short The derivatives of the transfer functions, used by backpropagation.
+     */
+    inline double identity_derivative(double weighted_sum) {return 1;}
+
+    inline double saturation_derivative(double weighted_sum,
+					double a) {
+      double res = weighted_sum*a;
+      if(res > 1 || res < -1)
+	return 0;
+      return 1;
+    }
+
+    inline double tanh_derivative(double weighted_sum,
+				  double a) {
+      double y = ::tanh(weighted_sum*a);
+      return a*(1-y*y);
+    }
+
+    /**
+     * @short This approximates the derivative of f by central differences.
+     */
+    inline std::function<double (double)> numerical_derivative(const std::function<double (double)>& f) {
+      return [f](double weighted_sum) {
+	double h = 1e-6*(1+std::fabs(weighted_sum));
+	return (f(weighted_sum+h)-f(weighted_sum-h))/(2*h);
+      };
+    }
   }
 
   namespace gsl {
     namespace mlp {
 
-      
+      /**
+       * @short The evaluation scratch of a network.
+       *
+       * The evaluations of an Output layer (value, gradient and batch)
+       * can be given a workspace, that receives all the intermediate
+       * values. The layers themselves hold no evaluation state, so a
+       * network can be evaluated by several threads at once, each one
+       * using its own workspace. The overloads without a workspace use
+       * a thread_local one. Workspaces are resized on demand, and
+       * Output::workspace() provides one with the right size.
+       */
+      class Workspace {
+      public:
+	std::vector<double> trace;  // the activations, see forward().
+	std::vector<double> delta;  // the derivatives of q, aligned with trace, see backward().
+	std::vector<double> batch;  // the layer outputs of a batch evaluation.
+	std::vector<double> theta;  // a contiguous copy of a strided theta, for batches.
+      };
 
       /**
        * @short This defines the input layer of the neural network.
@@ -78,7 +129,6 @@ namespace rl {
       class Input {
       private:
 
-	gsl_vector* xx;
 	std::function<void (gsl_vector*,const STATE&, const ACTION&)> phi;
 	unsigned int phi_dim;
 	
@@ -91,6 +141,8 @@ namespace rl {
 	unsigned int minParamRank(void) const {return 0;}
 	unsigned int nbParams(void)     const {return 0;}
 	unsigned int layerSize(void)    const {return phi_dim;}
+	unsigned int traceSize(void)    const {return phi_dim;}
+	unsigned int batchWidth(void)   const {return phi_dim;}
 	
 	unsigned int size;
 
@@ -101,41 +153,51 @@ namespace rl {
 	}
 
 	Input(const fctFEATURE& f, unsigned int feature_dimension) 
-	  : xx(0),
-	    phi(f),
+	  : phi(f),
 	    phi_dim(feature_dimension),
-	    size(0) {
-	  xx = gsl_vector_alloc(phi_dim);
-	}
+	    size(0) {}
 	Input(const Input<STATE,ACTION,fctFEATURE>& cp) 
-	  : xx(0), phi(cp.phi), phi_dim(cp.phi_dim), size(cp.size) {
-	  xx = gsl_vector_alloc(cp.xx->size);
-	  gsl_vector_memcpy(xx,cp.xx);
-	}
+	  : phi(cp.phi), phi_dim(cp.phi_dim), size(cp.size) {}
 
-	Input<STATE,ACTION,fctFEATURE> operator=(const Input<STATE,ACTION,fctFEATURE>& cp) {
+	Input<STATE,ACTION,fctFEATURE>& operator=(const Input<STATE,ACTION,fctFEATURE>& cp) {
 	  if(this != &cp) {
 	    phi = cp.phi;
 	    phi_dim = cp.phi_dim;
-	    gsl_vector_free(xx);
-	    xx = gsl_vector_alloc(phi_dim);
-	    gsl_vector_memcpy(xx,cp.xx);
 	    size = cp.size;
 	  }
-	  return this;
+	  return *this;
 	}
 
-	~Input(void) {gsl_vector_free(xx);}
-
 	void operator()(const gsl_vector* theta, 
 			const state_type& s, const action_type& a,
 			double* y) const {
-	  unsigned int i;
-	  phi(xx,s,a);
-	  double* end = y+layerSize();
-	  double* iter;
-	  for(iter = y, i=0; iter != end; ++i,++iter) 
-	    *iter = gsl_vector_get(xx,i);
+	  gsl_vector_view xx = gsl_vector_view_array(y,layerSize());
+	  phi(&(xx.vector),s,a);
+	}
+
+	/**
+	 * The trace of the input layer is the feature vector.
+	 */
+	void forward(const gsl_vector* theta, 
+		     const state_type& s, const action_type& a,
+		     double* trace) const {
+	  (*this)(theta,s,a,trace);
+	}
+
+	void backward(const gsl_vector* theta, 
+		      const double* trace, double* delta,
+		      gsl_vector* grad) const {}
+
+	/**
+	 * This writes the features of the batch_size (s,a) pairs as the
+	 * rows of y.
+	 */
+	template<typename STATE_ITERATOR, typename ACTION_ITERATOR>
+	void batch(const gsl_vector* theta,
+		   STATE_ITERATOR s, ACTION_ITERATOR a, std::size_t batch_size,
+		   double* y, double* scratch) const {
+	  for(std::size_t b = 0; b < batch_size; ++b, ++s, ++a, y += phi_dim)
+	    (*this)(theta,*s,*a,y);
 	}
       };
 
@@ -153,7 +215,6 @@ namespace rl {
       class Hidden {
       private:
 	unsigned int layer_size;
-	mutable std::vector<double> yy;
 
       public:
 	typedef typename PREVIOUS_LAYER::state_type  state_type;
@@ -161,12 +222,15 @@ namespace rl {
 
 	PREVIOUS_LAYER& input;
 	std::function<double (double)> f;
+	std::function<double (double)> df;
 	unsigned int size;
 	
 	unsigned int rank(void)         const {return 1+input.rank();}
 	unsigned int minParamRank(void) const {return input.minParamRank()+input.nbParams();}
 	unsigned int nbParams(void)     const {return layer_size*(1+input.layerSize());}
 	unsigned int layerSize(void)    const {return layer_size;}
+	unsigned int traceSize(void)    const {return input.traceSize()+2*layer_size;}
+	unsigned int batchWidth(void)   const {return input.batchWidth()+layer_size;}
 
 
 	void displayParameters(std::ostream& os) const {
@@ -176,48 +240,158 @@ namespace rl {
 	     << " : size = " << std::setw(4) << layerSize() << std::endl;
 	}
 
+	/**
+	 * The derivative of the transfer function is approximated
+	 * numerically for backpropagation.
+	 */
 	Hidden(PREVIOUS_LAYER& in,
 	       unsigned int nb_neurons,
 	       const MLP_TRANSFER& transfer) 
-	  : layer_size(nb_neurons), yy(), input(in), f(transfer) {
+	  : layer_size(nb_neurons), input(in), f(transfer), df() {
+	  df = rl::transfer::numerical_derivative(f);
+	  size = minParamRank() + nbParams();
+	}
+
+	template<typename MLP_TRANSFER_DERIVATIVE>
+	Hidden(PREVIOUS_LAYER& in,
+	       unsigned int nb_neurons,
+	       const MLP_TRANSFER& transfer,
+	       const MLP_TRANSFER_DERIVATIVE& transfer_derivative) 
+	  : layer_size(nb_neurons), input(in), f(transfer), df(transfer_derivative) {
 	  size = minParamRank() + nbParams();
 	}
 
 	Hidden(const Hidden<PREVIOUS_LAYER,MLP_TRANSFER>& cp) 
-	  : layer_size(cp.layer_size), yy(cp.yy), input(cp.input), f(cp.f), size(cp.size) {}
+	  : layer_size(cp.layer_size), input(cp.input), f(cp.f), df(cp.df), size(cp.size) {}
 
 	Hidden<PREVIOUS_LAYER,MLP_TRANSFER>& operator=(const Hidden<PREVIOUS_LAYER,MLP_TRANSFER>& cp) {
 	  if(this != &cp) {
 	    layer_size = cp.layer_size; 
-	    yy = cp.yy; 
 	    input = cp.input;
 	    f = cp.f;
+	    df = cp.df;
 	    size = cp.size;
 	  }
 	  return *this;
 	}
 
+	/**
+	 * This writes the layer outputs into y, the intermediate values
+	 * being stored in ws (see forward()).
+	 */
+	void operator()(const gsl_vector* theta,
+			const state_type& s, const action_type& a,
+			double* y, Workspace& ws) const {
+	  ws.trace.resize(traceSize());
+	  double* trace = &(*(ws.trace.begin()));
+	  forward(theta,s,a,trace);
+	  const double* out = trace + traceSize() - layer_size;
+	  std::copy(out,out+layer_size,y);
+	}
+
 	void operator()(const gsl_vector* theta,
 			const state_type& s, const action_type& a,
 			double* y) const {
-	  unsigned int k;
+	  thread_local Workspace ws;
+	  (*this)(theta,s,a,y,ws);
+	}
+
+	/**
+	 * This computes the layer outputs for batch_size (s,a) pairs at
+	 * once, the outputs being written as the rows of y. The weighted
+	 * sums are a single matrix product between the outputs of the
+	 * previous layer and the weights, read in place from theta, that
+	 * must be contiguous (see Output::batch). The scratch must hold
+	 * batch_size*input.batchWidth() values.
+	 */
+	template<typename STATE_ITERATOR, typename ACTION_ITERATOR>
+	void batch(const gsl_vector* theta,
+		   STATE_ITERATOR s, ACTION_ITERATOR a, std::size_t batch_size,
+		   double* y, double* scratch) const {
+	  unsigned int in_size = input.layerSize();
+	  double* x = scratch + batch_size*(input.batchWidth()-in_size);
+
+	  input.batch(theta,s,a,batch_size,x,scratch);
+
+	  // Row i of the weights is [bias_i, w_i1, ..., w_in].
+	  const double* w = theta->data + minParamRank();
+	  gsl_matrix_const_view X = gsl_matrix_const_view_array(x,batch_size,in_size);
+	  gsl_matrix_const_view W = gsl_matrix_const_view_array_with_tda(w+1,layer_size,in_size,in_size+1);
+	  gsl_matrix_view       Y = gsl_matrix_view_array(y,batch_size,layer_size);
+	  gsl_blas_dgemm(CblasNoTrans,CblasTrans,1,&(X.matrix),&(W.matrix),0,&(Y.matrix));
+
+	  for(std::size_t b = 0; b < batch_size; ++b)
+	    for(unsigned int i = 0; i < layer_size; ++i, ++y)
+	      *y = f(*y + w[i*(in_size+1)]);
+	}
+
+	/**
+	 * This computes the layer output as operator() does, keeping
+	 * the intermediate values for backward(). The trace is made of
+	 * the trace of the previous layer, followed by the weighted sums
+	 * and the outputs of this layer.
+	 */
+	void forward(const gsl_vector* theta,
+		     const state_type& s, const action_type& a,
+		     double* trace) const {
+	  unsigned int i,j;
+	  unsigned int in_size = input.layerSize();
+	  std::size_t stride = theta->stride;
+	  const double* w;
 	  double sum;
 
-	  yy.resize(input.layerSize());
-	  input(theta,s,a,&(*(yy.begin())));
+	  input.forward(theta,s,a,trace);
+	  const double* x = trace + input.traceSize() - in_size;
+	  double* sums    = trace + input.traceSize();
+	  double* y       = sums + layer_size;
+
+	  w = theta->data + minParamRank()*stride;
+	  for(i=0;i<layer_size;++i) {
+	    sum = *w; w += stride;
+	    for(j=0;j<in_size;++j,w += stride)
+	      sum += (*w)*x[j];
+	    sums[i] = sum;
+	    y[i]    = f(sum);
+	  }
+	}
 
-	  typename std::vector<double>::const_iterator j,yyend;
-	  double* i;
-	  double* yend = y+layerSize();
+	/**
+	 * The buffer delta is aligned with the trace, i.e. the derivative
+	 * of q with respect to some output is stored at the place of that
+	 * output in the trace. Given the derivatives with respect to the
+	 * outputs of this layer, this writes the gradient with respect to
+	 * the weights of this layer into grad, and backpropagates to the
+	 * previous layers.
+	 */
+	void backward(const gsl_vector* theta,
+		      const double* trace, double* delta,
+		      gsl_vector* grad) const {
+	  unsigned int i,j,k;
+	  unsigned int in_size = input.layerSize();
+	  bool propagate = minParamRank() > 0;
+	  double d;
+
+	  const double* x     = trace + input.traceSize() - in_size;
+	  const double* sums  = trace + input.traceSize();
+	  const double* dy    = delta + traceSize() - layer_size;
+	  double*  delta_in   = delta + input.traceSize() - in_size;
+
+	  if(propagate)
+	    std::fill(delta_in,delta_in+in_size,0.0);
 
 	  k=minParamRank();
-	  yyend = yy.end();
-	  for(i=y;i!=yend;++i) {
-	    sum = gsl_vector_get(theta,k);++k;
-	    for(j=yy.begin();j!=yyend;++j,++k)
-	      sum += gsl_vector_get(theta,k)*(*j);
-	    *i = f(sum);
+	  for(i=0;i<layer_size;++i) {
+	    d = dy[i]*df(sums[i]);
+	    gsl_vector_set(grad,k,d);++k;
+	    for(j=0;j<in_size;++j,++k) {
+	      gsl_vector_set(grad,k,d*x[j]);
+	      if(propagate)
+		delta_in[j] += gsl_vector_get(theta,k)*d;
+	    }
 	  }
+
+	  if(propagate)
+	    input.backward(theta,trace,delta,grad);
 	}
       };
 
@@ -228,13 +402,19 @@ namespace rl {
 	return Hidden<PREVIOUS_LAYER,MLP_TRANSFER>(in,layer_size,transfer);
       }
 
+      template<typename PREVIOUS_LAYER,typename MLP_TRANSFER,typename MLP_TRANSFER_DERIVATIVE>
+      Hidden<PREVIOUS_LAYER,MLP_TRANSFER> hidden(PREVIOUS_LAYER& in,
+						 unsigned int layer_size,
+						 const MLP_TRANSFER& transfer,
+						 const MLP_TRANSFER_DERIVATIVE& transfer_derivative) {
+	return Hidden<PREVIOUS_LAYER,MLP_TRANSFER>(in,layer_size,transfer,transfer_derivative);
+      }
+
       /**
        * @short This defines the output layer of the neural network.
        */
       template<typename PREVIOUS_LAYER,typename MLP_TRANSFER>
       class Output {
-      private:
-	mutable std::vector<double> y;
       public:
 
 	
@@ -245,9 +425,12 @@ namespace rl {
 	unsigned int minParamRank(void) const {return input.minParamRank()+input.nbParams();}
 	unsigned int nbParams(void)     const {return 1*(1+input.layerSize());}
 	unsigned int layerSize(void)    const {return 1;}
+	unsigned int traceSize(void)    const {return input.traceSize()+2;}
+	unsigned int batchWidth(void)   const {return input.batchWidth()+1;}
 	
 	PREVIOUS_LAYER& input;
 	std::function<double (double)> f;
+	std::function<double (double)> df;
 	unsigned int size;
 	
 
@@ -258,40 +441,165 @@ namespace rl {
 	     << " : size = " << std::setw(4) << layerSize() << std::endl;
 	}
 
+	/**
+	 * The derivative of the transfer function is approximated
+	 * numerically for backpropagation.
+	 */
 	Output(PREVIOUS_LAYER& in,
 	       const MLP_TRANSFER& transfer) 
-	  : y(),input(in), f(transfer) {
+	  : input(in), f(transfer), df() {
+	  df = rl::transfer::numerical_derivative(f);
 	  size = minParamRank() + nbParams();
 	}
+
+	template<typename MLP_TRANSFER_DERIVATIVE>
+	Output(PREVIOUS_LAYER& in,
+	       const MLP_TRANSFER& transfer,
+	       const MLP_TRANSFER_DERIVATIVE& transfer_derivative) 
+	  : input(in), f(transfer), df(transfer_derivative) {
+	  size = minParamRank() + nbParams();
+	}
+
 	Output(const Output<PREVIOUS_LAYER,MLP_TRANSFER>& cp)
-	  : y(cp.y), input(cp.input), f(cp.f), size(cp.size) {}
+	  : input(cp.input), f(cp.f), df(cp.df), size(cp.size) {}
 	Output<PREVIOUS_LAYER,MLP_TRANSFER>& operator=(const Output<PREVIOUS_LAYER,MLP_TRANSFER>& cp) {
 	  if(this != &cp) {
-	    y = cp.y; 
 	    input = cp.input;
 	    f = cp.f;
+	    df = cp.df;
 	    size = cp.size;
 	  }
 	  return *this;
 	}
 
 
-	double operator()(const gsl_vector* theta, const state_type& s, const action_type& a) const {
-	  unsigned int k;
+	/**
+	 * @return a workspace sized for the evaluation of this network.
+	 */
+	Workspace workspace(void) const {
+	  Workspace ws;
+	  ws.trace.resize(traceSize());
+	  ws.delta.resize(traceSize());
+	  return ws;
+	}
+
+	/**
+	 * @return q(theta,s,a), all the intermediate values being stored in ws.
+	 */
+	double operator()(const gsl_vector* theta, const state_type& s, const action_type& a,
+			  Workspace& ws) const {
+	  unsigned int in_size = input.layerSize();
+	  std::size_t stride = theta->stride;
+	  const double* w;
 	  double sum;
-	  
-	  y.resize(input.layerSize());
 
-	  input(theta,s,a,&(*(y.begin())));
+	  ws.trace.resize(traceSize());
+	  double* trace = &(*(ws.trace.begin()));
+	  input.forward(theta,s,a,trace);
+	  const double* x   = trace + input.traceSize() - in_size;
+	  const double* end = x + in_size;
+
+	  w = theta->data + minParamRank()*stride;
+	  sum = *w; w += stride;
+	  for(;x != end; ++x, w += stride)
+	    sum += (*w)*(*x);
+	  trace[traceSize()-2] = sum;
+	  return trace[traceSize()-1] = f(sum);
+	}
+
+	double operator()(const gsl_vector* theta, const state_type& s, const action_type& a) const {
+	  thread_local Workspace ws;
+	  return (*this)(theta,s,a,ws);
+	}
+
+	/**
+	 * This computes q(theta,s,a) for batch_size (s,a) pairs at once,
+	 * each layer being evaluated for the whole batch by a single
+	 * matrix product. The states and actions are read from the
+	 * iterators s and a, each one being incremented batch_size times,
+	 * and the values are written in q[0..batch_size[.
+	 */
+	template<typename STATE_ITERATOR, typename ACTION_ITERATOR>
+	void batch(const gsl_vector* theta,
+		   STATE_ITERATOR s, ACTION_ITERATOR a, std::size_t batch_size,
+		   double* q, Workspace& ws) const {
+	  unsigned int in_size = input.layerSize();
+	  gsl_vector_const_view contiguous_theta;
+
+	  if(batch_size == 0)
+	    return;
+
+	  // The weights are read in place as matrices.
+	  if(theta->stride != 1) {
+	    ws.theta.resize(theta->size);
+	    for(std::size_t i = 0; i < theta->size; ++i)
+	      ws.theta[i] = gsl_vector_get(theta,i);
+	    contiguous_theta = gsl_vector_const_view_array(&(*(ws.theta.begin())),theta->size);
+	    theta = &(contiguous_theta.vector);
+	  }
 
-	  typename std::vector<double>::const_iterator j,yend;
+	  ws.batch.resize(batch_size*input.batchWidth());
+	  double* scratch = &(*(ws.batch.begin()));
+	  double* x       = scratch + batch_size*(input.batchWidth()-in_size);
+	  input.batch(theta,s,a,batch_size,x,scratch);
 
+	  const double* w = theta->data + minParamRank();
+	  gsl_matrix_const_view X = gsl_matrix_const_view_array(x,batch_size,in_size);
+	  gsl_vector_const_view W = gsl_vector_const_view_array(w+1,in_size);
+	  gsl_vector_view       Q = gsl_vector_view_array(q,batch_size);
+	  gsl_blas_dgemv(CblasNoTrans,1,&(X.matrix),&(W.vector),0,&(Q.vector));
+
+	  for(std::size_t b = 0; b < batch_size; ++b)
+	    q[b] = f(q[b] + w[0]);
+	}
+
+	template<typename STATE_ITERATOR, typename ACTION_ITERATOR>
+	void batch(const gsl_vector* theta,
+		   STATE_ITERATOR s, ACTION_ITERATOR a, std::size_t batch_size,
+		   double* q) const {
+	  thread_local Workspace ws;
+	  batch(theta,s,a,batch_size,q,ws);
+	}
+
+	/**
+	 * This writes d q(theta,s,a) / d theta into grad, from a single
+	 * forward pass whose activations are reused by the backward
+	 * pass.
+	 * @return q(theta,s,a).
+	 */
+	double gradient(const gsl_vector* theta, gsl_vector* grad,
+			const state_type& s, const action_type& a,
+			Workspace& ws) const {
+	  unsigned int j,k;
+	  unsigned int in_size = input.layerSize();
+	  bool propagate = minParamRank() > 0;
+	  double q,d;
+
+	  q = (*this)(theta,s,a,ws);
+	  ws.delta.resize(traceSize());
+	  const double* trace = &(*(ws.trace.begin()));
+	  double*       delta = &(*(ws.delta.begin()));
+	  const double* x        = trace + input.traceSize() - in_size;
+	  double*       delta_in = delta + input.traceSize() - in_size;
+
+	  d = df(trace[traceSize()-2]);
 	  k=minParamRank();
-	  yend = y.end();
-	  sum = gsl_vector_get(theta,k);++k;
-	  for(j=y.begin();j!=yend;++j,++k)
-	    sum += gsl_vector_get(theta,k)*(*j);
-	  return f(sum);
+	  gsl_vector_set(grad,k,d);++k;
+	  for(j=0;j<in_size;++j,++k) {
+	    gsl_vector_set(grad,k,d*x[j]);
+	    if(propagate)
+	      delta_in[j] = gsl_vector_get(theta,k)*d;
+	  }
+
+	  if(propagate)
+	    input.backward(theta,trace,delta,grad);
+	  return q;
+	}
+
+	double gradient(const gsl_vector* theta, gsl_vector* grad,
+			const state_type& s, const action_type& a) const {
+	  thread_local Workspace ws;
+	  return gradient(theta,grad,s,a,ws);
 	}
       };
 
@@ -301,6 +609,34 @@ namespace rl {
 	return Output<PREVIOUS_LAYER,MLP_TRANSFER>(in,transfer);
       }
 
+      template<typename PREVIOUS_LAYER,typename MLP_TRANSFER,typename MLP_TRANSFER_DERIVATIVE>
+      Output<PREVIOUS_LAYER,MLP_TRANSFER> output(PREVIOUS_LAYER& in,
+						 const MLP_TRANSFER& transfer,
+						 const MLP_TRANSFER_DERIVATIVE& transfer_derivative) {
+	return Output<PREVIOUS_LAYER,MLP_TRANSFER>(in,transfer,transfer_derivative);
+      }
+
+      /**
+       * @short This is d q(theta,s,a) / d theta for a network, to be used as the grad_q argument of the first-order learners (rl::gsl::sarsa, rl::gsl::q_learning, ...).
+       */
+      template<typename OUTPUT_LAYER>
+      class Gradient {
+      private:
+	const OUTPUT_LAYER& output;
+      public:
+	Gradient(const OUTPUT_LAYER& out) : output(out) {}
+	void operator()(const gsl_vector* theta, gsl_vector* grad,
+			const typename OUTPUT_LAYER::state_type& s,
+			const typename OUTPUT_LAYER::action_type& a) const {
+	  output.gradient(theta,grad,s,a);
+	}
+      };
+
+      template<typename OUTPUT_LAYER>
+      Gradient<OUTPUT_LAYER> gradient(const OUTPUT_LAYER& out) {
+	return Gradient<OUTPUT_LAYER>(out);
+      }
+
     }
   }
 }
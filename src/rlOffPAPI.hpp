@@ -28,9 +28,16 @@
 
 #include <functional>
 
+#include <rlAlgo.hpp>
+#include <rlThreadPool.hpp>
+
 namespace rl {    
   /**
    * This performs a policy iteration.<br>
+   * The critic is run on the transitions, and then the next action
+   * of each non terminal transition is set to the greedy one
+   * according to q (see rl::argmax, that uses q.q_all when it is
+   * available).
    */
   template<typename BATCH_CRITIC, 
 	   typename TRANSITION_ITERATOR,
@@ -52,9 +59,47 @@ namespace rl {
     for(TRANSITION_ITERATOR iter = begin;iter != end; ++iter) {
       auto& t = *iter;
       if(!is_terminal(t))
-	set_next_action(t,
-			rl::argmax(std::bind(q,get_next_state(t),std::placeholders::_1),
-				   a_begin,a_end).first);
+	set_next_action(t,rl::argmax(q,get_next_state(t),a_begin,a_end).first);
     }
   }
+
+  /**
+   * This is batch_policy_iteration_step, the greedy re-labelling of
+   * the transitions being shared out among nb_threads threads (0
+   * means std::thread::hardware_concurrency()), each one handling a
+   * contiguous chunk of [begin,end[. q, is_terminal, get_next_state
+   * and set_next_action are thus called concurrently, on distinct
+   * transitions. rl::gsl::LinearQ and rl::gsl::Linear can be used
+   * that way. The critic is called once, as in the sequential
+   * version, so that it can be parallel by itself (see
+   * rl::parallel_lstd).
+   */
+  template<typename BATCH_CRITIC, 
+	   typename TRANSITION_ITERATOR,
+	   typename ACTION_ITERATOR,
+	   typename Q,
+	   typename fctIS_TERMINAL,
+	   typename fctGET_NEXT_STATE,
+	   typename fctSET_NEXT_ACTION>
+  void parallel_batch_policy_iteration_step(BATCH_CRITIC& critic,
+					    const Q& q,
+					    const TRANSITION_ITERATOR& begin,
+					    const TRANSITION_ITERATOR& end,
+					    const ACTION_ITERATOR& a_begin,
+					    const ACTION_ITERATOR& a_end,
+					    const fctIS_TERMINAL& is_terminal,
+					    const fctGET_NEXT_STATE& get_next_state,
+					    const fctSET_NEXT_ACTION& set_next_action,
+					    unsigned int nb_threads) {
+    critic(begin,end);
+    rl::ThreadPool pool(nb_threads);
+    pool.for_each_chunk(begin, end,
+			[&](const TRANSITION_ITERATOR& first, const TRANSITION_ITERATOR& last, unsigned int thread_id) {
+			  for(TRANSITION_ITERATOR iter = first; iter != last; ++iter) {
+			    auto& t = *iter;
+			    if(!is_terminal(t))
+			      set_next_action(t,rl::argmax(q,get_next_state(t),a_begin,a_end).first);
+			  }
+			});
+  }
 }
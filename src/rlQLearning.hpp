@@ -36,6 +36,8 @@
 #include <rlAlgo.hpp>
 #include <rlException.hpp>
 #include <rlTD.hpp>
+#include <rlSparse.hpp>
+#include <rlSnapshot.hpp>
 
 namespace rl {
 
@@ -49,19 +51,24 @@ namespace rl {
                 class QLearning {
 
                     public:
-                        using q_type  = std::function<double (const gsl_vector*, const STATE&, const ACTION&)>;
-                        using gq_type = std::function<void (const gsl_vector*,gsl_vector*,const STATE&, const ACTION&)>;
+                        using q_type   = std::function<double (const gsl_vector*, const STATE&, const ACTION&)>;
+                        using gq_type  = std::function<void (const gsl_vector*,gsl_vector*,const STATE&, const ACTION&)>;
+                        using sgq_type = std::function<void (const gsl_vector*,SparseVector&,const STATE&, const ACTION&)>;
 
                     protected:
 
                         // The parameter vector for the Q-function
                         gsl_vector* theta;
                         // A temporary vector holding the gradient of the value function
+                        // (null if the gradient is sparse)
                         gsl_vector* grad;
+                        // The same, when the gradient is sparse
+                        SparseVector sgrad;
                         // The parametrized Q(theta, s,a) function
                         q_type q;
-                        // The grad_theta Q(theta, s, a)
+                        // The grad_theta Q(theta, s, a), either dense or sparse
                         gq_type  gq;
+                        sgq_type sgq;
 
                         // Iterators over the collection of actions
                         ACTION_ITERATOR a_begin,a_end;
@@ -70,8 +77,21 @@ namespace rl {
                         // given we were in s executing action a
                         void td_update(const STATE& s, const ACTION& a, double td) {
                             // theta <- theta + alpha*td*grad
-                            gq(theta, grad, s, a);
-                            gsl_blas_daxpy(td*alpha, grad, theta);
+                            if(sgq) {
+                                sgrad.clear();
+                                sgq(theta, sgrad, s, a);
+                                if(concurrent)
+                                    sgrad.atomic_axpy(td*alpha, theta);
+                                else
+                                    sgrad.axpy(td*alpha, theta);
+                            }
+                            else {
+                                gq(theta, grad, s, a);
+                                if(concurrent)
+                                    rl::gsl::atomic_axpy(td*alpha, grad, theta);
+                                else
+                                    gsl_blas_daxpy(td*alpha, grad, theta);
+                            }
                         }
 
                     public:
@@ -82,11 +102,21 @@ namespace rl {
                         // The learning rate for theta
                         double alpha;
 
+                        // Set this to true when theta is shared by several
+                        // learners running in different threads. The updates of
+                        // theta are then made of relaxed atomic additions
+                        // (Hogwild-like), without any lock. The reads of theta
+                        // are not synchronized.
+                        bool concurrent;
+
                         QLearning(void) = delete;
                         QLearning(const QLearning<STATE,ACTION,ACTION_ITERATOR>& cp) = delete; 
                         QLearning<STATE,ACTION,ACTION_ITERATOR>& operator=(const QLearning<STATE,ACTION,ACTION_ITERATOR>& cp) = delete;
 
 
+                        /**
+                         * @param fct_grad_q Either fct_grad_q(theta, grad, s, a) with a gsl_vector* grad, or fct_grad_q(theta, sgrad, s, a) with a rl::gsl::SparseVector& sgrad. In the latter case, sgrad is given empty, and the update of theta is done in O(nnz).
+                         */
                         template<typename fctQ_PARAMETRIZED,
                                  typename fctGRAD_Q_PARAMETRIZED>
                         QLearning(gsl_vector* param,
@@ -96,12 +126,31 @@ namespace rl {
                                 const ACTION_ITERATOR& end,
                                 const fctQ_PARAMETRIZED& fct_q,
                                 const fctGRAD_Q_PARAMETRIZED& fct_grad_q):
-                            theta(param), grad(gsl_vector_alloc(param->size)), 
-                            q(fct_q), gq(fct_grad_q), a_begin(begin),a_end(end),
-                            gamma(gamma_coef), alpha(alpha_coef) {}
+                            theta(param), grad(nullptr), sgrad(param->size),
+                            q(fct_q), gq(), sgq(), a_begin(begin),a_end(end),
+                            gamma(gamma_coef), alpha(alpha_coef), concurrent(false) {
+                                if constexpr (rl::traits::gsl::is_sparse_parametrized_state_action_gradient<fctGRAD_Q_PARAMETRIZED, STATE, ACTION>::value)
+                                    sgq = fct_grad_q;
+                                else {
+                                    gq   = fct_grad_q;
+                                    grad = gsl_vector_alloc(param->size);
+                                }
+                            }
 
                         virtual ~QLearning(void) {
-                            gsl_vector_free(grad);
+                            if(grad)
+                                gsl_vector_free(grad);
+                        }
+
+                        /**
+                         * This adds theta to a binary snapshot, as prefix + "theta".
+                         */
+                        void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                            writer.add(prefix + "theta", theta);
+                        }
+
+                        void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                            mapping.copy(prefix + "theta", theta);
                         }
 
                         double td_error(const STATE& s, const ACTION& a,
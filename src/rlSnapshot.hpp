@@ -0,0 +1,398 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <rlException.hpp>
+
+namespace rl {
+
+    /**
+     * @short Binary snapshots of the learners' parameters.
+     *
+     * A snapshot file is a 64-byte header, followed by a table of
+     * named arrays, followed by the raw doubles of each array in
+     * native byte order. Each array starts at an offset that is a
+     * multiple of 64. Matrices are stored row by row. Scalars are
+     * stored as 1x1 arrays.
+     *
+     * Learners provide write(rl::snapshot::Writer&, prefix) and
+     * read(rl::snapshot::Mapping&, prefix). Reading a snapshot maps
+     * the file in memory and copies each array in place, without
+     * any parsing, so that a warm start costs about as much as a
+     * memcpy. The arrays of a rl::snapshot::Mapping can also be used
+     * directly as gsl views, e.g. as the parameter of a q-function
+     * that only serves requests.
+     */
+    namespace snapshot {
+
+        /**
+         * The format version, written in the header. Files with
+         * another version are rejected.
+         */
+        constexpr std::uint32_t version = 1;
+
+        constexpr std::size_t alignment = 64;
+        constexpr std::size_t max_name_length = 39;
+
+        struct Header {
+            char          magic[8];   // "RLSNAP\0\0"
+            std::uint32_t version;
+            std::uint32_t byte_order; // 0x01020304 as written by the host.
+            std::uint64_t nb_arrays;
+            std::uint64_t alignment;
+            std::uint64_t reserved[4];
+        };
+
+        struct Entry {
+            char          name[max_name_length+1];
+            std::uint64_t size1;
+            std::uint64_t size2;
+            std::uint64_t offset;     // From the beginning of the file.
+        };
+
+        static_assert(sizeof(Header) == 64, "rl::snapshot::Header must be 64 bytes long");
+        static_assert(sizeof(Entry)  == 64, "rl::snapshot::Entry must be 64 bytes long");
+
+        inline const char* magic(void) {
+            return "RLSNAP\0";
+        }
+
+        constexpr std::uint32_t byte_order = 0x01020304;
+
+        /**
+         * @short Collects the arrays of a snapshot and writes them.
+         *
+         * The writer only keeps pointers to the gsl data, so the
+         * vectors and matrices that are added must not be freed
+         * before the snapshot is written.
+         */
+        class Writer {
+
+            private:
+
+                struct Array {
+                    std::string   name;
+                    const double* data;
+                    std::size_t   size1;
+                    std::size_t   size2;
+                    std::size_t   stride; // Between two elements of a row.
+                    std::size_t   tda;    // Between two rows.
+                    double        value;  // The data of scalars.
+                };
+
+                std::vector<Array> arrays;
+
+                void push(const std::string& name, const double* data,
+                          std::size_t size1, std::size_t size2,
+                          std::size_t stride, std::size_t tda, double value) {
+                    if(name.size() > max_name_length)
+                        throw rl::exception::BadSnapshot(std::string("array name too long : ") + name);
+                    for(auto& a : arrays)
+                        if(a.name == name)
+                            throw rl::exception::BadSnapshot(std::string("duplicated array name : ") + name);
+                    arrays.push_back({name, data, size1, size2, stride, tda, value});
+                }
+
+                static std::size_t aligned(std::size_t offset) {
+                    return ((offset + alignment - 1) / alignment) * alignment;
+                }
+
+            public:
+
+                void add(const std::string& name, const gsl_vector* v) {
+                    push(name, v->data, v->size, 1, v->stride, v->stride, 0);
+                }
+
+                void add(const std::string& name, const gsl_matrix* m) {
+                    push(name, m->data, m->size1, m->size2, 1, m->tda, 0);
+                }
+
+                void add(const std::string& name, double value) {
+                    push(name, nullptr, 1, 1, 1, 1, value);
+                }
+
+                std::size_t size(void) const {
+                    return arrays.size();
+                }
+
+                void write(std::ostream& os) const {
+                    Header header;
+                    std::memset(&header, 0, sizeof(Header));
+                    std::memcpy(header.magic, magic(), sizeof(header.magic));
+                    header.version    = version;
+                    header.byte_order = byte_order;
+                    header.nb_arrays  = arrays.size();
+                    header.alignment  = alignment;
+                    os.write((const char*)(&header), sizeof(Header));
+
+                    std::size_t offset = aligned(sizeof(Header) + arrays.size()*sizeof(Entry));
+                    for(auto& a : arrays) {
+                        Entry entry;
+                        std::memset(&entry, 0, sizeof(Entry));
+                        std::strncpy(entry.name, a.name.c_str(), max_name_length);
+                        entry.size1  = a.size1;
+                        entry.size2  = a.size2;
+                        entry.offset = offset;
+                        os.write((const char*)(&entry), sizeof(Entry));
+                        offset = aligned(offset + a.size1*a.size2*sizeof(double));
+                    }
+
+                    std::size_t written = sizeof(Header) + arrays.size()*sizeof(Entry);
+                    std::vector<char> padding(alignment, 0);
+                    std::vector<double> row;
+                    for(auto& a : arrays) {
+                        std::size_t start = aligned(written);
+                        os.write(padding.data(), start - written);
+                        if(a.data == nullptr)
+                            os.write((const char*)(&a.value), sizeof(double));
+                        else if(a.stride == 1)
+                            for(std::size_t i = 0; i < a.size1; ++i)
+                                os.write((const char*)(a.data + i*a.tda), a.size2*sizeof(double));
+                        else {
+                            // A strided vector view, stored as a column.
+                            row.resize(a.size1);
+                            for(std::size_t i = 0; i < a.size1; ++i)
+                                row[i] = a.data[i*a.stride];
+                            os.write((const char*)(row.data()), a.size1*sizeof(double));
+                        }
+                        written = start + a.size1*a.size2*sizeof(double);
+                    }
+                    std::size_t end = aligned(written);
+                    os.write(padding.data(), end - written);
+                }
+
+                /**
+                 * This writes the snapshot in path + ".tmp" and then
+                 * renames it as path, so that the file never appears
+                 * half-written, and so that processes that have
+                 * mapped a previous version keep a consistent one.
+                 */
+                void save(const std::string& path) const {
+                    std::string tmp = path + ".tmp";
+                    {
+                        std::ofstream file(tmp.c_str(), std::ios::binary | std::ios::trunc);
+                        if(!file)
+                            throw rl::exception::BadSnapshot(std::string("cannot open ") + tmp + " for writing");
+                        write(file);
+                        file.close();
+                        if(!file)
+                            throw rl::exception::BadSnapshot(std::string("cannot write ") + tmp);
+                    }
+                    if(std::rename(tmp.c_str(), path.c_str()) != 0) {
+                        std::remove(tmp.c_str());
+                        throw rl::exception::BadSnapshot(std::string("cannot rename ") + tmp + " as " + path);
+                    }
+                }
+        };
+
+        /**
+         * @short A snapshot file mapped in memory.
+         *
+         * The file is mapped privately: the arrays can be modified in
+         * memory (copy-on-write) but the file is never modified. The
+         * pages are only loaded when they are accessed. The views
+         * returned by vector() and matrix() are valid as long as the
+         * mapping lives.
+         */
+        class Mapping {
+
+            private:
+
+                char*         base;
+                std::size_t   length;
+                const Header* header;
+                const Entry*  entries;
+
+                static std::string dimensions(std::size_t size1, std::size_t size2) {
+                    return std::to_string(size1) + "x" + std::to_string(size2);
+                }
+
+                void check(void) const {
+                    if(length < sizeof(Header)
+                       || std::memcmp(header->magic, magic(), sizeof(header->magic)) != 0)
+                        throw rl::exception::BadSnapshot("not a snapshot file");
+                    if(header->byte_order != byte_order)
+                        throw rl::exception::BadSnapshot("the file has been written with another byte order");
+                    if(header->version != version)
+                        throw rl::exception::BadSnapshot(std::string("version ") + std::to_string(header->version)
+                                                         + " found while version " + std::to_string(version) + " is expected");
+                    if(header->nb_arrays > (length - sizeof(Header))/sizeof(Entry))
+                        throw rl::exception::BadSnapshot("truncated array table");
+                    for(std::uint64_t k = 0; k < header->nb_arrays; ++k) {
+                        const Entry& e = entries[k];
+                        if(e.name[max_name_length] != '\0'
+                           || e.offset % alignment != 0
+                           || (e.size2 != 0 && e.size1 > length/sizeof(double)/e.size2)
+                           || e.offset > length
+                           || e.size1*e.size2*sizeof(double) > length - e.offset)
+                            throw rl::exception::BadSnapshot(std::string("corrupted entry for array ") + std::to_string(k));
+                    }
+                }
+
+                double* data(const Entry& e) const {
+                    return (double*)(base + e.offset);
+                }
+
+            public:
+
+                Mapping(const std::string& path)
+                    : base(nullptr), length(0), header(nullptr), entries(nullptr) {
+                    int fd = ::open(path.c_str(), O_RDONLY);
+                    if(fd < 0)
+                        throw rl::exception::BadSnapshot(std::string("cannot open ") + path);
+                    struct stat st;
+                    if(::fstat(fd, &st) != 0 || st.st_size == 0) {
+                        ::close(fd);
+                        throw rl::exception::BadSnapshot(std::string("cannot map ") + path);
+                    }
+                    length = st.st_size;
+                    void* addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                    ::close(fd);
+                    if(addr == MAP_FAILED)
+                        throw rl::exception::BadSnapshot(std::string("cannot map ") + path);
+                    base    = (char*)addr;
+                    header  = (const Header*)base;
+                    entries = (const Entry*)(base + sizeof(Header));
+                    try {
+                        check();
+                    }
+                    catch(...) {
+                        ::munmap(base, length);
+                        throw;
+                    }
+                }
+
+                Mapping(const Mapping& cp) = delete;
+                Mapping& operator=(const Mapping& cp) = delete;
+
+                ~Mapping() {
+                    ::munmap(base, length);
+                }
+
+                std::size_t size(void) const {
+                    return header->nb_arrays;
+                }
+
+                std::string name(std::size_t k) const {
+                    return entries[k].name;
+                }
+
+                bool has(const std::string& name) const {
+                    for(std::uint64_t k = 0; k < header->nb_arrays; ++k)
+                        if(name == entries[k].name)
+                            return true;
+                    return false;
+                }
+
+                const Entry& entry(const std::string& name) const {
+                    for(std::uint64_t k = 0; k < header->nb_arrays; ++k)
+                        if(name == entries[k].name)
+                            return entries[k];
+                    throw rl::exception::BadSnapshot(std::string("no array named ") + name);
+                }
+
+                /**
+                 * @return a view on a n x 1 array.
+                 */
+                gsl_vector_view vector(const std::string& name) {
+                    const Entry& e = entry(name);
+                    if(e.size2 != 1)
+                        throw rl::exception::BadSnapshot(name + " is a " + dimensions(e.size1, e.size2) + " matrix, not a vector");
+                    return gsl_vector_view_array(data(e), e.size1);
+                }
+
+                gsl_matrix_view matrix(const std::string& name) {
+                    const Entry& e = entry(name);
+                    return gsl_matrix_view_array(data(e), e.size1, e.size2);
+                }
+
+                double scalar(const std::string& name) const {
+                    const Entry& e = entry(name);
+                    if(e.size1 != 1 || e.size2 != 1)
+                        throw rl::exception::BadSnapshot(name + " is a " + dimensions(e.size1, e.size2) + " matrix, not a scalar");
+                    return *(data(e));
+                }
+
+                /**
+                 * This copies the named array into v, that must have the same size.
+                 */
+                void copy(const std::string& name, gsl_vector* v) {
+                    gsl_vector_view view = vector(name);
+                    if(view.vector.size != v->size)
+                        throw rl::exception::BadVectorSize(view.vector.size, v->size, std::string("rl::snapshot::Mapping::copy ") + name);
+                    gsl_vector_memcpy(v, &(view.vector));
+                }
+
+                /**
+                 * This copies the named array into m, that must have the same dimensions.
+                 */
+                void copy(const std::string& name, gsl_matrix* m) {
+                    const Entry& e = entry(name);
+                    if(e.size1 != m->size1 || e.size2 != m->size2)
+                        throw rl::exception::BadSnapshot(name + " is a " + dimensions(e.size1, e.size2)
+                                                         + " matrix while a " + dimensions(m->size1, m->size2) + " one is expected");
+                    gsl_matrix_view view = gsl_matrix_view_array(data(e), e.size1, e.size2);
+                    gsl_matrix_memcpy(m, &(view.matrix));
+                }
+        };
+
+        /**
+         * This writes the snapshot of a learner, i.e. any object
+         * providing learner.write(writer, prefix), in path.
+         */
+        template<typename LEARNER>
+            void save(const LEARNER& learner, const std::string& path) {
+                Writer writer;
+                learner.write(writer, "");
+                writer.save(path);
+            }
+
+        /**
+         * This restores the learner, i.e. any object providing
+         * learner.read(mapping, prefix), from the snapshot in path.
+         */
+        template<typename LEARNER>
+            void load(LEARNER& learner, const std::string& path) {
+                Mapping mapping(path);
+                learner.read(mapping, "");
+            }
+    }
+}
@@ -0,0 +1,469 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_blas.h>
+
+namespace rl {
+
+    namespace gsl {
+
+        /**
+         * *p <- *p + v, as a relaxed atomic operation. This is used
+         * for lock-free (Hogwild-like) updates of a parameter vector
+         * shared by several threads.
+         */
+        inline void atomic_add(double* p, double v) {
+#if defined(__GNUC__)
+            double expected, desired;
+            __atomic_load(p, &expected, __ATOMIC_RELAXED);
+            do {
+                desired = expected + v;
+            } while(!__atomic_compare_exchange(p, &expected, &desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#else
+            *p += v;
+#endif
+        }
+
+        /**
+         * y <- y + alpha*x, each component being added atomically.
+         */
+        inline void atomic_axpy(double alpha, const gsl_vector* x, gsl_vector* y) {
+            std::size_t n = x->size;
+            for(std::size_t i = 0; i < n; ++i) {
+                double xi = x->data[i*x->stride];
+                if(xi != 0)
+                    atomic_add(y->data + i*y->stride, alpha*xi);
+            }
+        }
+
+        /**
+         * @short Sparse vector, stored as (index, value) pairs.
+         *
+         * This is meant to hold gradients where only a few components
+         * are not null (tabular or tile coded representations). A
+         * gradient function filling a SparseVector rather than a
+         * gsl_vector lets the learners update the parameter in
+         * O(nnz) instead of O(n). Indices are not checked, and
+         * duplicated indices are summed when the vector is applied.
+         */
+        class SparseVector {
+
+            private:
+
+                std::vector<std::size_t> idx;
+                std::vector<double>      val;
+
+            public:
+
+                // The dimension of the dense vector this sparse vector stands for.
+                std::size_t size;
+
+                SparseVector(void) : idx(), val(), size(0) {}
+                SparseVector(std::size_t dimension) : idx(), val(), size(dimension) {}
+                SparseVector(const SparseVector& cp) = default;
+                SparseVector& operator=(const SparseVector& cp) = default;
+
+                /**
+                 * This removes all the non null components. The
+                 * memory is kept for further use.
+                 */
+                void clear(void) {
+                    idx.clear();
+                    val.clear();
+                }
+
+                /**
+                 * This adds value to the i-th component, by appending
+                 * the entry (i, value). Entries with the same index
+                 * are summed when the vector is applied. Call clear()
+                 * first to start a new vector.
+                 */
+                void add(std::size_t i, double value) {
+                    idx.push_back(i);
+                    val.push_back(value);
+                }
+
+                /**
+                 * This makes the vector be the i-th vector of the canonical basis.
+                 */
+                void set_basis(std::size_t i) {
+                    clear();
+                    add(i,1);
+                }
+
+                /**
+                 * @return the number of stored components.
+                 */
+                std::size_t nnz(void) const {
+                    return idx.size();
+                }
+
+                std::size_t index(std::size_t k) const {return idx[k];}
+                double      value(std::size_t k) const {return val[k];}
+
+                /**
+                 * y <- y + alpha*this, in O(nnz).
+                 */
+                void axpy(double alpha, gsl_vector* y) const {
+                    double* data   = y->data;
+                    std::size_t stride = y->stride;
+                    std::size_t n      = idx.size();
+                    for(std::size_t k = 0; k < n; ++k)
+                        data[idx[k]*stride] += alpha*val[k];
+                }
+
+                /**
+                 * y <- y + alpha*this, in O(nnz), each component being
+                 * added atomically.
+                 */
+                void atomic_axpy(double alpha, gsl_vector* y) const {
+                    double* data   = y->data;
+                    std::size_t stride = y->stride;
+                    std::size_t n      = idx.size();
+                    for(std::size_t k = 0; k < n; ++k)
+                        atomic_add(data + idx[k]*stride, alpha*val[k]);
+                }
+
+                /**
+                 * @return this^T.y, in O(nnz).
+                 */
+                double dot(const gsl_vector* y) const {
+                    const double* data = y->data;
+                    std::size_t stride = y->stride;
+                    std::size_t n      = idx.size();
+                    double res = 0;
+                    for(std::size_t k = 0; k < n; ++k)
+                        res += val[k]*data[idx[k]*stride];
+                    return res;
+                }
+
+                /**
+                 * This writes the dense version of the vector into y.
+                 */
+                void copy_to(gsl_vector* y) const {
+                    gsl_vector_set_zero(y);
+                    axpy(1,y);
+                }
+        };
+
+        /**
+         * @short Sparse matrix, stored in the compressed sparse row (CSR) format.
+         *
+         * Entries are first added as (row, column, value) triplets
+         * (the COO format). The pending triplets are sorted and merged
+         * into the CSR arrays by compress(), duplicates being summed.
+         * This is done automatically when the pending triplets
+         * outnumber the compressed entries, so that the memory stays
+         * proportional to the number of distinct non null entries
+         * even when the same entries are accumulated many times.
+         */
+        class SparseMatrix {
+
+            private:
+
+                struct Entry {
+                    std::size_t i, j;
+                    double      v;
+                };
+
+                std::vector<std::size_t> row_start; // size1+1 offsets in col and val.
+                std::vector<std::size_t> col;
+                std::vector<double>      val;
+                std::vector<Entry>       pending;
+
+                void auto_compress(void) {
+                    if(pending.size() >= std::max<std::size_t>(val.size(), 1 << 16))
+                        compress();
+                }
+
+            public:
+
+                std::size_t size1, size2;
+
+                SparseMatrix(void) : SparseMatrix(0, 0) {}
+                SparseMatrix(std::size_t nb_rows, std::size_t nb_cols)
+                    : row_start(nb_rows+1, 0), col(), val(), pending(),
+                      size1(nb_rows), size2(nb_cols) {}
+                SparseMatrix(const SparseMatrix& cp) = default;
+                SparseMatrix& operator=(const SparseMatrix& cp) = default;
+
+                /**
+                 * This removes all the entries. The memory is kept for further use.
+                 */
+                void clear(void) {
+                    std::fill(row_start.begin(), row_start.end(), 0);
+                    col.clear();
+                    val.clear();
+                    pending.clear();
+                }
+
+                /**
+                 * (i,j) <- (i,j) + value.
+                 */
+                void add(std::size_t i, std::size_t j, double value) {
+                    pending.push_back({i, j, value});
+                    auto_compress();
+                }
+
+                /**
+                 * this <- this + alpha*x*y^T, in O(nnz(x)*nnz(y)).
+                 */
+                void add_outer(double alpha, const SparseVector& x, const SparseVector& y) {
+                    std::size_t nx = x.nnz();
+                    std::size_t ny = y.nnz();
+                    for(std::size_t k = 0; k < nx; ++k) {
+                        double ax = alpha*x.value(k);
+                        for(std::size_t l = 0; l < ny; ++l)
+                            pending.push_back({x.index(k), y.index(l), ax*y.value(l)});
+                    }
+                    auto_compress();
+                }
+
+                /**
+                 * This merges the pending entries into the CSR arrays.
+                 */
+                void compress(void) {
+                    if(pending.empty())
+                        return;
+
+                    std::sort(pending.begin(), pending.end(),
+                            [](const Entry& a, const Entry& b) {
+                                return a.i < b.i || (a.i == b.i && a.j < b.j);
+                            });
+
+                    std::vector<std::size_t> new_row_start(size1+1, 0);
+                    std::vector<std::size_t> new_col;
+                    std::vector<double>      new_val;
+                    new_col.reserve(val.size() + pending.size());
+                    new_val.reserve(val.size() + pending.size());
+
+                    auto p = pending.begin();
+                    for(std::size_t i = 0; i < size1; ++i) {
+                        std::size_t row_begin = new_col.size();
+                        std::size_t k         = row_start[i];
+                        std::size_t k_end     = row_start[i+1];
+                        // Both the CSR row and the pending entries of
+                        // row i are sorted by column, they are merged.
+                        while(k < k_end || (p != pending.end() && p->i == i)) {
+                            std::size_t j;
+                            double      v;
+                            if(k < k_end && (p == pending.end() || p->i != i || col[k] <= p->j)) {
+                                j = col[k];
+                                v = val[k++];
+                            }
+                            else {
+                                j = p->j;
+                                v = (p++)->v;
+                            }
+                            if(new_col.size() > row_begin && new_col.back() == j)
+                                new_val.back() += v;
+                            else {
+                                new_col.push_back(j);
+                                new_val.push_back(v);
+                            }
+                        }
+                        new_row_start[i+1] = new_col.size();
+                    }
+
+                    row_start.swap(new_row_start);
+                    col.swap(new_col);
+                    val.swap(new_val);
+                    pending.clear();
+                }
+
+                /**
+                 * @return the number of compressed entries.
+                 */
+                std::size_t nnz(void) const {
+                    return val.size();
+                }
+
+                /**
+                 * y <- this*x. Only the compressed entries are used.
+                 */
+                void mult(const gsl_vector* x, gsl_vector* y) const {
+                    const double* xd = x->data;
+                    std::size_t   xs = x->stride;
+                    for(std::size_t i = 0; i < size1; ++i) {
+                        double sum = 0;
+                        for(std::size_t k = row_start[i]; k < row_start[i+1]; ++k)
+                            sum += val[k]*xd[col[k]*xs];
+                        y->data[i*y->stride] = sum;
+                    }
+                }
+
+                /**
+                 * This writes the diagonal into d. Only the compressed entries are used.
+                 */
+                void diagonal(gsl_vector* d) const {
+                    gsl_vector_set_zero(d);
+                    for(std::size_t i = 0; i < size1 && i < size2; ++i)
+                        for(std::size_t k = row_start[i]; k < row_start[i+1]; ++k)
+                            if(col[k] == i)
+                                d->data[i*d->stride] = val[k];
+                }
+        };
+
+        /**
+         * @short This solves A.x = b by the BiCGSTAB method, with a Jacobi preconditioner.
+         *
+         * A needs to be square but not symmetric, and only its
+         * compressed entries are used. x is the initial guess, it is
+         * overwritten by the solution. The iterations stop when
+         * |b - A.x| <= tol*|b|, or when max_iter is reached. When the
+         * method breaks down, or when the residual it updates has
+         * drifted from the actual one, it is restarted from the
+         * current x.
+         * @param converged is set to true if the actual residual
+         * |b - A.x| of the returned x is within tol*|b|, false if
+         * max_iter has been reached before.
+         * @return the number of iterations done.
+         */
+        inline std::size_t bicgstab(const SparseMatrix& A, const gsl_vector* b, gsl_vector* x,
+                double tol, std::size_t max_iter, bool& converged) {
+            std::size_t n = A.size1;
+            gsl_vector* inv_diag = gsl_vector_alloc(n);
+            gsl_vector* r        = gsl_vector_alloc(n);
+            gsl_vector* r0       = gsl_vector_alloc(n);
+            gsl_vector* p        = gsl_vector_calloc(n);
+            gsl_vector* v        = gsl_vector_calloc(n);
+            gsl_vector* y        = gsl_vector_alloc(n);
+            gsl_vector* z        = gsl_vector_alloc(n);
+            gsl_vector* t        = gsl_vector_alloc(n);
+
+            A.diagonal(inv_diag);
+            for(std::size_t i = 0; i < n; ++i) {
+                double d = gsl_vector_get(inv_diag, i);
+                gsl_vector_set(inv_diag, i, d != 0 ? 1/d : 1);
+            }
+
+            double threshold = tol*gsl_blas_dnrm2(b);
+            double rho, alpha, omega;
+            std::size_t iter = 0;
+
+            // This (re)starts the method from the current x. It is
+            // also used when the method breaks down.
+            auto restart = [&]() {
+                // r = b - A.x
+                A.mult(x, r);
+                gsl_vector_scale(r, -1);
+                gsl_blas_daxpy(1, b, r);
+                gsl_vector_memcpy(r0, r);
+                gsl_vector_set_zero(p);
+                gsl_vector_set_zero(v);
+                rho = alpha = omega = 1;
+            };
+            restart();
+
+            while(iter < max_iter) {
+                if(gsl_blas_dnrm2(r) <= threshold) {
+                    // The updated residual may drift away from the
+                    // actual one, which is checked before stopping.
+                    restart();
+                    if(gsl_blas_dnrm2(r) <= threshold)
+                        break;
+                }
+                ++iter;
+                double rho_next;
+                gsl_blas_ddot(r0, r, &rho_next);
+                if(rho_next == 0 || omega == 0) {
+                    restart();
+                    continue;
+                }
+
+                // p = r + beta*(p - omega*v)
+                double beta = (rho_next/rho)*(alpha/omega);
+                rho = rho_next;
+                gsl_blas_daxpy(-omega, v, p);
+                gsl_vector_scale(p, beta);
+                gsl_vector_add(p, r);
+
+                // y = K^-1.p, v = A.y
+                gsl_vector_memcpy(y, p);
+                gsl_vector_mul(y, inv_diag);
+                A.mult(y, v);
+
+                double r0v;
+                gsl_blas_ddot(r0, v, &r0v);
+                if(r0v == 0) {
+                    restart();
+                    continue;
+                }
+                alpha = rho/r0v;
+
+                // x += alpha*y, and r becomes s = r - alpha*v
+                gsl_blas_daxpy(alpha, y, x);
+                gsl_blas_daxpy(-alpha, v, r);
+                if(gsl_blas_dnrm2(r) <= threshold)
+                    continue;
+
+                // z = K^-1.s, t = A.z
+                gsl_vector_memcpy(z, r);
+                gsl_vector_mul(z, inv_diag);
+                A.mult(z, t);
+
+                double tt, ts;
+                gsl_blas_ddot(t, t, &tt);
+                gsl_blas_ddot(t, r, &ts);
+                if(tt == 0) {
+                    restart();
+                    continue;
+                }
+                omega = ts/tt;
+
+                gsl_blas_daxpy(omega, z, x);
+                gsl_blas_daxpy(-omega, t, r);
+            }
+
+            // The actual residual, rather than the updated one.
+            restart();
+            converged = gsl_blas_dnrm2(r) <= threshold;
+
+            gsl_vector_free(t);
+            gsl_vector_free(z);
+            gsl_vector_free(y);
+            gsl_vector_free(v);
+            gsl_vector_free(p);
+            gsl_vector_free(r0);
+            gsl_vector_free(r);
+            gsl_vector_free(inv_diag);
+            return iter;
+        }
+
+        inline std::size_t bicgstab(const SparseMatrix& A, const gsl_vector* b, gsl_vector* x,
+                double tol, std::size_t max_iter) {
+            bool converged;
+            return bicgstab(A, b, x, tol, max_iter, converged);
+        }
+    }
+}
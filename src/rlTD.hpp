@@ -26,8 +26,12 @@
 
 #pragma once
 
+#include <functional>
 #include <rlTraits.hpp>
+#include <rlSparse.hpp>
+#include <rlSnapshot.hpp>
 #include <gsl/gsl_vector.h>
+#include <gsl/gsl_blas.h>
 
 namespace rl {
 
@@ -43,27 +47,45 @@ namespace rl {
 
                 public:
 
-                    using v_type  = std::function<double (const gsl_vector*,const STATE&)>;
-                    using gv_type = std::function<void (const gsl_vector*,gsl_vector*,const STATE&)>;
+                    using v_type   = std::function<double (const gsl_vector*,const STATE&)>;
+                    using gv_type  = std::function<void (const gsl_vector*,gsl_vector*,const STATE&)>;
+                    using sgv_type = std::function<void (const gsl_vector*,SparseVector&,const STATE&)>;
 
                 protected:
 
                     // The parameter vector for the V-function
                     gsl_vector* theta;
                     // A temporary vector holding the gradient of the value function
+                    // (null if the gradient is sparse)
                     gsl_vector* grad;
+                    // The same, when the gradient is sparse
+                    SparseVector sgrad;
 
                     // The parametrized V(theta, s) function
                     v_type  v;
-                    // The parametrized grad_theta V(theta, s)
-                    gv_type gv;
+                    // The parametrized grad_theta V(theta, s), either dense or sparse
+                    gv_type  gv;
+                    sgv_type sgv;
 
                     // The function computing the update of the parameter vector
                     // given we were in s executing action a
                     void td_update(const STATE& s, double td) {
                         // theta <- theta + alpha*td*grad
-                        gv(theta, grad, s);
-                        gsl_blas_daxpy(td*alpha, grad, theta);
+                        if(sgv) {
+                            sgrad.clear();
+                            sgv(theta, sgrad, s);
+                            if(concurrent)
+                                sgrad.atomic_axpy(td*alpha, theta);
+                            else
+                                sgrad.axpy(td*alpha, theta);
+                        }
+                        else {
+                            gv(theta, grad, s);
+                            if(concurrent)
+                                rl::gsl::atomic_axpy(td*alpha, grad, theta);
+                            else
+                                gsl_blas_daxpy(td*alpha, grad, theta);
+                        }
                     }
 
                 public:
@@ -74,10 +96,20 @@ namespace rl {
                     // The learning rate for theta
                     double alpha;
 
+                    // Set this to true when theta is shared by several
+                    // learners running in different threads. The updates of
+                    // theta are then made of relaxed atomic additions
+                    // (Hogwild-like), without any lock. The reads of theta
+                    // are not synchronized.
+                    bool concurrent;
+
                     TD(void)   = delete;
                     TD(const TD<STATE>& cp) = delete;
                     TD<STATE>& operator=(const TD<STATE>& cp) = delete;
 
+                    /**
+                     * @param fct_grad_v Either fct_grad_v(theta, grad, s) with a gsl_vector* grad, or fct_grad_v(theta, sgrad, s) with a rl::gsl::SparseVector& sgrad. In the latter case, sgrad is given empty, and the update of theta is done in O(nnz).
+                     */
                     template<typename fctV,
                              typename fctGRAD_V>
                             TD(gsl_vector* param,
@@ -86,12 +118,31 @@ namespace rl {
                                     const fctV&      fct_v,
                                     const fctGRAD_V& fct_grad_v)
                             : theta(param),
-                            grad(gsl_vector_alloc(param->size)),
-                            v(fct_v), gv(fct_grad_v),
-                            gamma(gamma_coef), alpha(alpha_coef) {}
+                            grad(nullptr), sgrad(param->size),
+                            v(fct_v), gv(), sgv(),
+                            gamma(gamma_coef), alpha(alpha_coef), concurrent(false) {
+                                if constexpr (rl::traits::gsl::is_sparse_parametrized_state_gradient<fctGRAD_V, STATE>::value)
+                                    sgv = fct_grad_v;
+                                else {
+                                    gv   = fct_grad_v;
+                                    grad = gsl_vector_alloc(param->size);
+                                }
+                            }
 
                     virtual ~TD(void) {
-                        gsl_vector_free(grad);
+                        if(grad)
+                            gsl_vector_free(grad);
+                    }
+
+                    /**
+                     * This adds theta to a binary snapshot, as prefix + "theta".
+                     */
+                    void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                        writer.add(prefix + "theta", theta);
+                    }
+
+                    void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                        mapping.copy(prefix + "theta", theta);
                     }
 
                     double td_error(const STATE& s, double r, const STATE& s_) {
@@ -134,28 +185,46 @@ namespace rl {
 
                 public:
 
-                    using q_type  = std::function<double (const gsl_vector*, const STATE&, const ACTION&)>;
-                    using gq_type = std::function<void (const gsl_vector*,gsl_vector*,const STATE&, const ACTION&)>;
+                    using q_type   = std::function<double (const gsl_vector*, const STATE&, const ACTION&)>;
+                    using gq_type  = std::function<void (const gsl_vector*,gsl_vector*,const STATE&, const ACTION&)>;
+                    using sgq_type = std::function<void (const gsl_vector*,SparseVector&,const STATE&, const ACTION&)>;
 
                 protected:
 
                     // The parameter vector for the Q-function
                     gsl_vector* theta;
                     // A temporary vector holding the gradient of the value function
+                    // (null if the gradient is sparse)
                     gsl_vector* grad;
+                    // The same, when the gradient is sparse
+                    SparseVector sgrad;
 
                     // The parametrized Q(theta, s, a) function
                     q_type  q;
-                    // The parametrized grad_theta Q(theta, s, a)
-                    gq_type gq;
+                    // The parametrized grad_theta Q(theta, s, a), either dense or sparse
+                    gq_type  gq;
+                    sgq_type sgq;
 
                         
                     // The function computing the update of the parameter vector
                     // given we were in s executing action a
                     void td_update(const STATE& s, const ACTION& a, double td) {
                         // theta <- theta + alpha*td*grad
-                        gq(theta, grad, s, a);
-                        gsl_blas_daxpy(td*alpha, grad, theta);
+                        if(sgq) {
+                            sgrad.clear();
+                            sgq(theta, sgrad, s, a);
+                            if(concurrent)
+                                sgrad.atomic_axpy(td*alpha, theta);
+                            else
+                                sgrad.axpy(td*alpha, theta);
+                        }
+                        else {
+                            gq(theta, grad, s, a);
+                            if(concurrent)
+                                rl::gsl::atomic_axpy(td*alpha, grad, theta);
+                            else
+                                gsl_blas_daxpy(td*alpha, grad, theta);
+                        }
                     }
 
                 public:
@@ -166,10 +235,20 @@ namespace rl {
                     // The learning rate for theta
                     double alpha;
 
+                    // Set this to true when theta is shared by several
+                    // learners running in different threads. The updates of
+                    // theta are then made of relaxed atomic additions
+                    // (Hogwild-like), without any lock. The reads of theta
+                    // are not synchronized.
+                    bool concurrent;
+
                     TD(void) = delete;
                     TD(const TD<STATE, ACTION>& cp) = delete;
                     TD<STATE, ACTION>& operator=(const TD<STATE, ACTION>& cp) = delete;
                     
+                    /**
+                     * @param fct_grad_q Either fct_grad_q(theta, grad, s, a) with a gsl_vector* grad, or fct_grad_q(theta, sgrad, s, a) with a rl::gsl::SparseVector& sgrad. In the latter case, sgrad is given empty, and the update of theta is done in O(nnz).
+                     */
                     template<typename fctQ,
                         typename fctGRAD_Q>
                             TD(gsl_vector* param,
@@ -178,13 +257,32 @@ namespace rl {
                                     const fctQ&      fct_q,
                                     const fctGRAD_Q& fct_grad_q)
                             : theta(param),
-                            grad(gsl_vector_alloc(param->size)),
-                            q(fct_q), gq(fct_grad_q),
-                            gamma(gamma_coef), alpha(alpha_coef) { }
+                            grad(nullptr), sgrad(param->size),
+                            q(fct_q), gq(), sgq(),
+                            gamma(gamma_coef), alpha(alpha_coef), concurrent(false) {
+                                if constexpr (rl::traits::gsl::is_sparse_parametrized_state_action_gradient<fctGRAD_Q, STATE, ACTION>::value)
+                                    sgq = fct_grad_q;
+                                else {
+                                    gq   = fct_grad_q;
+                                    grad = gsl_vector_alloc(param->size);
+                                }
+                            }
 
 
                     virtual ~TD(void) {
-                        gsl_vector_free(grad);
+                        if(grad)
+                            gsl_vector_free(grad);
+                    }
+
+                    /**
+                     * This adds theta to a binary snapshot, as prefix + "theta".
+                     */
+                    void write(rl::snapshot::Writer& writer, const std::string& prefix = "") const {
+                        writer.add(prefix + "theta", theta);
+                    }
+
+                    void read(rl::snapshot::Mapping& mapping, const std::string& prefix = "") {
+                        mapping.copy(prefix + "theta", theta);
                     }
 
                     double td_error(const STATE& s, const ACTION& a, double r, const STATE& s_, const ACTION& a_) {
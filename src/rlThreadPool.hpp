@@ -0,0 +1,211 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <iterator>
+#include <cstddef>
+
+namespace rl {
+
+    /**
+     * @short A fixed set of worker threads, used to split loops.
+     *
+     * The pool is made of size() threads, including the calling
+     * one, so that a pool of size 1 runs everything sequentially in
+     * the caller. The workers are created once, at construction,
+     * and sleep between jobs. Jobs are blocking: run and
+     * parallel_for return when all the threads are done. If some
+     * thread raises an exception, it is rethrown in the caller.
+     *
+     * A pool runs one job at a time. If several threads submit jobs
+     * to the same pool, the jobs are serialized.
+     */
+    class ThreadPool {
+
+        private:
+
+            std::vector<std::thread>          workers;
+            std::mutex                        mutex;
+            std::mutex                        submit_mutex;
+            std::condition_variable           job_ready;
+            std::condition_variable           job_done;
+            std::function<void (unsigned int)> job;
+            std::exception_ptr                error;
+            unsigned long                     generation;
+            unsigned int                      pending;
+            bool                              stop;
+
+            void work(unsigned int thread_id) {
+                unsigned long seen = 0;
+                while(true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        job_ready.wait(lock, [this, &seen]() {return stop || generation != seen;});
+                        if(stop)
+                            return;
+                        seen = generation;
+                    }
+                    execute(thread_id);
+                }
+            }
+
+            void execute(unsigned int thread_id) {
+                try {
+                    job(thread_id);
+                }
+                catch(...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(!error)
+                        error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if(--pending == 0)
+                    job_done.notify_all();
+            }
+
+        public:
+
+            ThreadPool(void) = delete;
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            /**
+             * @param nb_threads The number of threads, including the calling one. 0 means std::thread::hardware_concurrency().
+             */
+            ThreadPool(unsigned int nb_threads)
+                : workers(), mutex(), submit_mutex(), job_ready(), job_done(),
+                job(), error(), generation(0), pending(0), stop(false) {
+                    if(nb_threads == 0)
+                        nb_threads = std::thread::hardware_concurrency();
+                    if(nb_threads == 0)
+                        nb_threads = 1;
+                    workers.reserve(nb_threads-1);
+                    for(unsigned int t = 1; t < nb_threads; ++t)
+                        workers.emplace_back(&ThreadPool::work, this, t);
+                }
+
+            ~ThreadPool(void) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stop = true;
+                }
+                job_ready.notify_all();
+                for(auto& w : workers)
+                    w.join();
+            }
+
+            /**
+             * @return the number of threads, including the calling one.
+             */
+            unsigned int size(void) const {
+                return workers.size()+1;
+            }
+
+            /**
+             * This calls f(thread_id) for each thread_id in [0,size()[,
+             * concurrently. The calling thread has the id 0.
+             */
+            template<typename fctJOB>
+                void run(const fctJOB& f) {
+                    std::lock_guard<std::mutex> submit(submit_mutex);
+                    if(workers.empty()) {
+                        f(0);
+                        return;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        job     = std::cref(f);
+                        error   = nullptr;
+                        pending = size();
+                        ++generation;
+                    }
+                    job_ready.notify_all();
+                    execute(0);
+                    std::exception_ptr e;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        job_done.wait(lock, [this]() {return pending == 0;});
+                        job = nullptr;
+                        e   = error;
+                    }
+                    if(e)
+                        std::rethrow_exception(e);
+                }
+
+            /**
+             * This calls f(i, thread_id) for each i in [0,n[. The range
+             * is split into size() contiguous chunks, thread t handling
+             * the t-th one.
+             */
+            template<typename fctBODY>
+                void parallel_for(std::size_t n, const fctBODY& f) {
+                    std::size_t nb = size();
+                    if(nb == 1 || n < 2) {
+                        for(std::size_t i = 0; i < n; ++i)
+                            f(i, 0u);
+                        return;
+                    }
+                    run([n, nb, &f](unsigned int thread_id) {
+                            std::size_t first = (n * thread_id)     / nb;
+                            std::size_t last  = (n * (thread_id+1)) / nb;
+                            for(std::size_t i = first; i < last; ++i)
+                                f(i, thread_id);
+                        });
+                }
+
+            /**
+             * This calls f(first, last, thread_id), [first,last[ being
+             * the thread_id-th of size() contiguous chunks of
+             * [begin,end[. A forward iterator is enough, the chunk
+             * bounds being found by a single walk through the range.
+             */
+            template<typename ITERATOR, typename fctCHUNK>
+                void for_each_chunk(const ITERATOR& begin, const ITERATOR& end, const fctCHUNK& f) {
+                    std::size_t nb = size();
+                    std::size_t n  = std::distance(begin, end);
+                    std::vector<ITERATOR> bounds;
+                    bounds.reserve(nb+1);
+                    ITERATOR    it  = begin;
+                    std::size_t pos = 0;
+                    for(std::size_t c = 0; c <= nb; ++c) {
+                        std::size_t next_pos = (n * c) / nb;
+                        std::advance(it, next_pos - pos);
+                        pos = next_pos;
+                        bounds.push_back(it);
+                    }
+                    run([&bounds, &f](unsigned int thread_id) {
+                            f(bounds[thread_id], bounds[thread_id+1], thread_id);
+                        });
+                }
+    };
+}
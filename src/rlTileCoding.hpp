@@ -0,0 +1,211 @@
+/*   This file is part of rl-lib
+ *
+ *   Copyright (C) 2010,  Supelec
+ *
+ *   Author : Herve Frezza-Buet and Matthieu Geist
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@supelec.fr Matthieu.Geist@supelec.fr
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <gsl/gsl_vector.h>
+
+#include <rlException.hpp>
+#include <rlSparse.hpp>
+
+namespace rl {
+
+    namespace gsl {
+
+        /**
+         * @short Tile coding of a DIM-dimensional continuous input.
+         *
+         * The input domain [min,max] is split, along each dimension,
+         * into intervals. This grid is a tiling. nb_tilings copies of
+         * that grid are used, each one being shifted by a fraction of
+         * a tile width (asymmetric displacements 1,3,5... as advised
+         * by Sutton and Barto). An input activates exactly one tile
+         * per tiling, so the feature vector is binary, with
+         * nb_tilings ones.
+         *
+         * If hash_size is not null, tiles are hashed into a table of
+         * that size, which bounds the memory when the grids are very
+         * fine or when the dimension is high. Otherwise, each tile has
+         * its own feature.
+         *
+         * Only the active indices are computed. They can be written
+         * in a rl::gsl::SparseVector (for TD, SARSA, Q-learning) or
+         * in a dense gsl_vector (for LSTD, KTD), and theta^T.phi can
+         * be computed in O(nb_tilings).
+         *
+         * For a Q-function, the features of (s,a) are usually obtained
+         * with an offset of rank(a)*size(), the parameter being of
+         * dimension nb_actions*size().
+         */
+        template<std::size_t DIM>
+            class TileCoding {
+
+                public:
+
+                    using input_type = std::array<double,DIM>;
+
+                private:
+
+                    std::size_t                nb_tilings;
+                    std::size_t                hash_size;
+                    std::array<double,DIM>     min;
+                    std::array<double,DIM>     inv_width;
+                    std::array<std::size_t,DIM> nb_tiles;
+                    std::array<std::size_t,DIM> stride;
+                    std::size_t                tiles_per_tiling;
+
+                    static std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+                        h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+                        h ^= h >> 33;
+                        h *= 0xff51afd7ed558ccdULL;
+                        h ^= h >> 33;
+                        return h;
+                    }
+
+                    std::size_t tile(std::size_t t, const input_type& x) const {
+                        std::size_t   idx = 0;
+                        std::uint64_t h   = t;
+                        for(std::size_t d = 0; d < DIM; ++d) {
+                            double shift = (double)((t*(2*d+1)) % nb_tilings)/nb_tilings;
+                            double c     = std::floor((x[d] - min[d])*inv_width[d] + shift);
+                            std::size_t ic;
+                            if(c < 0)
+                                ic = 0;
+                            else if(c >= nb_tiles[d])
+                                ic = nb_tiles[d]-1;
+                            else
+                                ic = (std::size_t)c;
+                            if(hash_size)
+                                h = mix(h,ic);
+                            else
+                                idx += ic*stride[d];
+                        }
+                        if(hash_size)
+                            return (std::size_t)(h % hash_size);
+                        return t*tiles_per_tiling + idx;
+                    }
+
+                public:
+
+                    TileCoding(void) = delete;
+                    TileCoding(const TileCoding<DIM>& cp) = default;
+                    TileCoding<DIM>& operator=(const TileCoding<DIM>& cp) = default;
+
+                    /**
+                     * @param tilings The number of tilings.
+                     * @param min_bounds The lower bounds of the input domain.
+                     * @param max_bounds The upper bounds of the input domain.
+                     * @param nb_intervals The number of intervals of a tiling, for each dimension.
+                     * @param hashing The size of the hash table, 0 for no hashing.
+                     */
+                    TileCoding(std::size_t tilings,
+                            const input_type& min_bounds,
+                            const input_type& max_bounds,
+                            const std::array<std::size_t,DIM>& nb_intervals,
+                            std::size_t hashing = 0)
+                        : nb_tilings(tilings), hash_size(hashing),
+                        min(min_bounds), inv_width(), nb_tiles(), stride(),
+                        tiles_per_tiling(1) {
+                            if(nb_tilings == 0)
+                                throw rl::exception::Any("in rl::gsl::TileCoding : at least one tiling is required");
+                            for(std::size_t d = 0; d < DIM; ++d) {
+                                if(nb_intervals[d] == 0 || !(max_bounds[d] > min_bounds[d]))
+                                    throw rl::exception::Any("in rl::gsl::TileCoding : bad tiling specification");
+                                inv_width[d] = nb_intervals[d]/(max_bounds[d]-min_bounds[d]);
+                                // One extra tile is needed for the shifted tilings.
+                                nb_tiles[d]  = nb_intervals[d]+1;
+                                stride[d]    = tiles_per_tiling;
+                                tiles_per_tiling *= nb_tiles[d];
+                            }
+                        }
+
+                    /**
+                     * @return the number of features.
+                     */
+                    std::size_t size(void) const {
+                        if(hash_size)
+                            return hash_size;
+                        return nb_tilings*tiles_per_tiling;
+                    }
+
+                    /**
+                     * @return the number of active features, i.e. the number of tilings.
+                     */
+                    std::size_t nb_active(void) const {
+                        return nb_tilings;
+                    }
+
+                    /**
+                     * This writes the nb_active() active indices, shifted by offset.
+                     */
+                    template<typename OUTPUT_ITER>
+                        void active(const input_type& x, OUTPUT_ITER out, std::size_t offset = 0) const {
+                            for(std::size_t t = 0; t < nb_tilings; ++t)
+                                *(out++) = offset + tile(t,x);
+                        }
+
+                    /**
+                     * phi <- phi(x), as a sparse vector.
+                     */
+                    void operator()(SparseVector& phi, const input_type& x, std::size_t offset = 0) const {
+                        phi.clear();
+                        for(std::size_t t = 0; t < nb_tilings; ++t)
+                            phi.add(offset + tile(t,x), 1);
+                    }
+
+                    /**
+                     * phi <- phi(x), as a dense vector.
+                     */
+                    void operator()(gsl_vector* phi, const input_type& x, std::size_t offset = 0) const {
+                        if(phi == (gsl_vector*)0)
+                            throw rl::exception::NullVectorPtr("in rl::gsl::TileCoding::operator()");
+                        gsl_vector_set_zero(phi);
+                        for(std::size_t t = 0; t < nb_tilings; ++t) {
+                            std::size_t i = offset + tile(t,x);
+                            if(i >= phi->size)
+                                throw rl::exception::BadVectorSize(phi->size,i+1,"in rl::gsl::TileCoding::operator()");
+                            *gsl_vector_ptr(phi,i) += 1;
+                        }
+                    }
+
+                    /**
+                     * @return theta^T.phi(x), in O(nb_tilings).
+                     */
+                    double dot(const gsl_vector* theta, const input_type& x, std::size_t offset = 0) const {
+                        const double* data = theta->data;
+                        std::size_t   inc  = theta->stride;
+                        double res = 0;
+                        for(std::size_t t = 0; t < nb_tilings; ++t)
+                            res += data[(offset + tile(t,x))*inc];
+                        return res;
+                    }
+            };
+    }
+}
@@ -27,10 +27,15 @@
 #pragma once
 
 #include <type_traits>
+#include <new>
 #include <gsl/gsl_vector.h>
 
 namespace rl {
 
+  namespace gsl {
+    class SparseVector;
+  }
+
   namespace traits {
 
     template <typename...>
@@ -77,6 +82,46 @@ namespace rl {
     struct is_sarsa_critic<CRITIC, S, A,
 			   void_t<decltype(std::declval<CRITIC>().learn(std::declval<const S>(), std::declval<const A>(), std::declval<double>(), std::declval<const S>(), std::declval<const A>()))>> : std::true_type {};    
 
+
+    /**
+     * This detects simulators providing the exception-free transition
+     * bool timeStep(const ACTION& a, std::nothrow_t), that returns true
+     * when a terminal state is reached rather than raising
+     * rl::exception::Terminal.
+     */
+    template<typename SIMULATOR, typename A, typename=void>
+    struct has_nothrow_time_step: std::false_type {};
+
+    template<typename SIMULATOR, typename A>
+    struct has_nothrow_time_step<SIMULATOR, A,
+				 void_t<decltype(bool(std::declval<SIMULATOR&>().timeStep(std::declval<const A>(), std::nothrow)))>> : std::true_type {};
+
+
+    /**
+     * This detects Q-functions that can evaluate all the actions at
+     * once, i.e. that provide q.q_all(s, values), values being a
+     * double* where Q(s,a) is written for each action, in the order
+     * of the action iterators.
+     */
+    template<typename Q, typename S, typename=void>
+    struct has_q_all: std::false_type {};
+
+    template<typename Q, typename S>
+    struct has_q_all<Q, S,
+		     void_t<decltype(std::declval<const Q&>().q_all(std::declval<const S&>(), std::declval<double*>()))>> : std::true_type {};
+
+    /**
+     * This detects critics that can share their parameter with other
+     * critics running in other threads, i.e. that provide a public bool
+     * concurrent attribute.
+     */
+    template<typename CRITIC, typename=void>
+    struct has_concurrent_mode: std::false_type {};
+
+    template<typename CRITIC>
+    struct has_concurrent_mode<CRITIC,
+			       void_t<decltype(std::declval<CRITIC&>().concurrent = true)>> : std::true_type {};
+
     
     namespace gsl {
       
@@ -95,6 +140,40 @@ namespace rl {
       struct is_parametrized_state_action_value_function<F, S, A,
 							 void_t<decltype(std::declval<F>()(std::declval<const gsl_vector*>(), std::declval<const S>(), std::declval<const A>()))>> : std::true_type {};
 
+
+      /**
+       * This detects gradient functions that fill a
+       * rl::gsl::SparseVector, i.e. grad(theta, sparse_grad, s).
+       */
+      template <typename F, typename S, typename=void>
+      struct is_sparse_parametrized_state_gradient : std::false_type {};
+
+      template <typename F, typename S>
+      struct is_sparse_parametrized_state_gradient<F, S, 
+						   void_t<decltype(std::declval<F>()(std::declval<const gsl_vector*>(), std::declval<rl::gsl::SparseVector&>(), std::declval<const S>()))>> : std::true_type {};
+
+      /**
+       * This detects gradient functions that fill a
+       * rl::gsl::SparseVector, i.e. grad(theta, sparse_grad, s, a).
+       */
+      template <typename F, typename S, typename A, typename=void>
+      struct is_sparse_parametrized_state_action_gradient : std::false_type {};
+
+      template <typename F, typename S, typename A>
+      struct is_sparse_parametrized_state_action_gradient<F, S, A,
+							  void_t<decltype(std::declval<F>()(std::declval<const gsl_vector*>(), std::declval<rl::gsl::SparseVector&>(), std::declval<const S>(), std::declval<const A>()))>> : std::true_type {};
+
+      /**
+       * This detects feature functions that fill a
+       * rl::gsl::SparseVector, i.e. phi(sparse_phi, s, a).
+       */
+      template <typename F, typename S, typename A, typename=void>
+      struct is_sparse_state_action_feature : std::false_type {};
+
+      template <typename F, typename S, typename A>
+      struct is_sparse_state_action_feature<F, S, A,
+					    void_t<decltype(std::declval<F>()(std::declval<rl::gsl::SparseVector&>(), std::declval<const S>(), std::declval<const A>()))>> : std::true_type {};
+
     }
   }
 }